@@ -2,6 +2,7 @@
 from .messaging_pyx import Context, Poller, SubSocket, PubSocket, SocketEventHandle, toggle_fake_events, \
                                 set_fake_prefix, get_fake_prefix, delete_fake_prefix, wait_for_one_event
 from .messaging_pyx import MultiplePublishersError, MessagingError
+from .messaging_pyx import pubsub_trace_enabled, trace_send, trace_recv
 
 import os
 import capnp
@@ -22,6 +23,7 @@ assert delete_fake_prefix
 assert wait_for_one_event
 
 NO_TRAVERSAL_LIMIT = 2**64-1
+PUBSUB_TRACE = pubsub_trace_enabled()
 
 context = Context()
 
@@ -241,6 +243,8 @@ class SubMaster:
         continue
 
       s = msg.which()
+      if PUBSUB_TRACE:
+        trace_recv(s, msg.logMonoTime, msg.total_size.word_count * 8)
       self.seen[s] = True
       self.updated[s] = True
 
@@ -301,8 +305,12 @@ class PubMaster:
       self.sock[s] = pub_sock(s)
 
   def send(self, s: str, dat: Union[bytes, capnp.lib.capnp._DynamicStructBuilder]) -> None:
+    if PUBSUB_TRACE:
+      log_mono_time = log_from_bytes(dat).logMonoTime if isinstance(dat, bytes) else dat.logMonoTime
     if not isinstance(dat, bytes):
       dat = dat.to_bytes()
+    if PUBSUB_TRACE:
+      trace_send(s, log_mono_time, len(dat))
     self.sock[s].send(dat)
 
   def wait_for_readers_to_update(self, s: str, timeout: int, dt: float = 0.05) -> bool:
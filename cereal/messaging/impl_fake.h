@@ -46,13 +46,22 @@ public:
   }
 
   Message *receive(bool non_blocking=false) override {
+    wait_recv_ready();
+    return TSubSocket::receive(non_blocking);
+  }
+
+  kj::ArrayPtr<const capnp::word> receiveAligned(AlignedBuffer &buf, bool non_blocking=false) override {
+    wait_recv_ready();
+    return TSubSocket::receiveAligned(buf, non_blocking);
+  }
+
+private:
+  void wait_recv_ready() {
     if (this->state->enabled) {
       this->recv_called->set();
       this->recv_ready->wait();
       this->recv_ready->clear();
     }
-
-    return TSubSocket::receive(non_blocking);
   }
 };
 
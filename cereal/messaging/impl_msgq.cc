@@ -20,6 +20,18 @@ static bool service_exists(std::string path){
   return services.count(path) > 0;
 }
 
+// Publishers and subscribers of a service must agree on the size, endpoints outside the service list use the default
+static size_t segment_size(std::string path){
+  auto it = services.find(path);
+  return it != services.end() ? it->second.segment_size : DEFAULT_SEGMENT_SIZE;
+}
+
+// Same for the number of reader slots
+static size_t reader_slots(std::string path){
+  auto it = services.find(path);
+  return it != services.end() ? it->second.reader_slots : NUM_READERS;
+}
+
 
 MSGQContext::MSGQContext() {
 }
@@ -63,12 +75,15 @@ int MSGQSubSocket::connect(Context *context, std::string endpoint, std::string a
   }
 
   q = new msgq_queue_t;
-  int r = msgq_new_queue(q, endpoint.c_str(), DEFAULT_SEGMENT_SIZE);
+  int r = msgq_new_queue(q, endpoint.c_str(), segment_size(endpoint));
   if (r != 0){
     return r;
   }
 
-  msgq_init_subscriber(q);
+  r = msgq_init_subscriber(q, reader_slots(endpoint));
+  if (r != 0){
+    return r;
+  }
 
   if (conflate){
     q->read_conflate = true;
@@ -136,6 +151,25 @@ Message * MSGQSubSocket::receive(bool non_blocking){
   return (Message*)r;
 }
 
+kj::ArrayPtr<const capnp::word> MSGQSubSocket::receiveAligned(AlignedBuffer &buf, bool non_blocking){
+  if (!non_blocking){
+    return SubSocket::receiveAligned(buf, non_blocking);
+  }
+
+  // Copy directly out of the ring, retry if the writer overwrote the message during the copy
+  msgq_msg_t msg;
+  while (msgq_msg_borrow(&msg, q) > 0){
+    auto words = buf.align(msg.data, msg.size);
+    if (msgq_msg_release(q) == 0){
+      errno = 0;
+      return words;
+    }
+  }
+
+  errno = 0;
+  return {};
+}
+
 void MSGQSubSocket::setTimeout(int t){
   timeout = t;
 }
@@ -155,12 +189,12 @@ int MSGQPubSocket::connect(Context *context, std::string endpoint, bool check_en
   }
 
   q = new msgq_queue_t;
-  int r = msgq_new_queue(q, endpoint.c_str(), DEFAULT_SEGMENT_SIZE);
+  int r = msgq_new_queue(q, endpoint.c_str(), segment_size(endpoint));
   if (r != 0){
     return r;
   }
 
-  msgq_init_publisher(q);
+  msgq_init_publisher(q, reader_slots(endpoint));
 
   return 0;
 }
@@ -181,6 +215,16 @@ int MSGQPubSocket::send(char *data, size_t size){
   return msgq_msg_send(&msg, q);
 }
 
+int MSGQPubSocket::sendBatch(const std::vector<kj::ArrayPtr<capnp::byte>> &msgs){
+  batch.resize(msgs.size());
+  for (size_t i = 0; i < msgs.size(); i++){
+    batch[i].data = (char *)msgs[i].begin();
+    batch[i].size = msgs[i].size();
+  }
+
+  return msgq_msg_send_batch(batch.data(), batch.size(), q);
+}
+
 bool MSGQPubSocket::all_readers_updated() {
   return msgq_all_readers_updated(q);
 }
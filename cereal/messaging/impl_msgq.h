@@ -40,16 +40,19 @@ public:
   void setTimeout(int timeout);
   void * getRawSocket() {return (void*)q;}
   Message *receive(bool non_blocking=false);
+  kj::ArrayPtr<const capnp::word> receiveAligned(AlignedBuffer &buf, bool non_blocking=false);
   ~MSGQSubSocket();
 };
 
 class MSGQPubSocket : public PubSocket {
 private:
   msgq_queue_t * q = NULL;
+  std::vector<msgq_msg_t> batch;
 public:
   int connect(Context *context, std::string endpoint, bool check_endpoint=true);
   int sendMessage(Message *message);
   int send(char *data, size_t size);
+  int sendBatch(const std::vector<kj::ArrayPtr<capnp::byte>> &msgs);
   bool all_readers_updated();
   ~MSGQPubSocket();
 };
@@ -71,6 +71,26 @@ SubSocket * SubSocket::create(Context * context, std::string endpoint, std::stri
   }
 }
 
+kj::ArrayPtr<const capnp::word> SubSocket::receiveAligned(AlignedBuffer &buf, bool non_blocking){
+  Message *msg = receive(non_blocking);
+  if (msg == nullptr){
+    return {};
+  }
+
+  auto words = buf.align(msg);
+  delete msg;
+  return words;
+}
+
+int PubSocket::sendBatch(const std::vector<kj::ArrayPtr<capnp::byte>> &msgs){
+  for (auto &msg : msgs){
+    if (send((char *)msg.begin(), msg.size()) < 0){
+      return -1;
+    }
+  }
+  return msgs.size();
+}
+
 PubSocket * PubSocket::create(){
   PubSocket * s;
   if (messaging_use_zmq()){
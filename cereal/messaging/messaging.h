@@ -36,12 +36,15 @@ public:
   virtual ~Message(){}
 };
 
+class AlignedBuffer;
 
 class SubSocket {
 public:
   virtual int connect(Context *context, std::string endpoint, std::string address, bool conflate=false, bool check_endpoint=true) = 0;
   virtual void setTimeout(int timeout) = 0;
   virtual Message *receive(bool non_blocking=false) = 0;
+  // Receive straight into a word aligned buffer, skipping the intermediate Message. Empty if nothing was received
+  virtual kj::ArrayPtr<const capnp::word> receiveAligned(AlignedBuffer &buf, bool non_blocking=false);
   virtual void * getRawSocket() = 0;
   static SubSocket * create();
   static SubSocket * create(Context * context, std::string endpoint, std::string address="127.0.0.1", bool conflate=false, bool check_endpoint=true);
@@ -53,6 +56,8 @@ public:
   virtual int connect(Context *context, std::string endpoint, bool check_endpoint=true) = 0;
   virtual int sendMessage(Message *message) = 0;
   virtual int send(char *data, size_t size) = 0;
+  // Publishes all messages at once, readers are woken up a single time. Returns the number of messages sent or -1
+  virtual int sendBatch(const std::vector<kj::ArrayPtr<capnp::byte>> &msgs);
   virtual bool all_readers_updated() = 0;
   static PubSocket * create();
   static PubSocket * create(Context * context, std::string endpoint, bool check_endpoint=true);
@@ -71,8 +76,10 @@ public:
 
 class SubMaster {
 public:
+  // services in drain keep every message received in an update, see messages()
   SubMaster(const std::vector<const char *> &service_list, const std::vector<const char *> &poll = {},
-            const char *address = nullptr, const std::vector<const char *> &ignore_alive = {});
+            const char *address = nullptr, const std::vector<const char *> &ignore_alive = {},
+            const std::vector<const char *> &drain = {});
   void update(int timeout = 1000);
   void update_msgs(uint64_t current_time, const std::vector<std::pair<std::string, cereal::Event::Reader>> &messages);
   inline bool allAlive(const std::vector<const char *> &service_list = {}) { return all_(service_list, false, true); }
@@ -88,6 +95,8 @@ public:
   uint64_t rcv_frame(const char *name) const;
   uint64_t rcv_time(const char *name) const;
   cereal::Event::Reader &operator[](const char *name) const;
+  // All messages of a drained service received in the last update, oldest first. Valid until the next update
+  const std::vector<cereal::Event::Reader> &messages(const char *name) const;
 
 private:
   bool all_(const std::vector<const char *> &service_list, bool valid, bool alive);
@@ -100,6 +109,8 @@ private:
 class MessageBuilder : public capnp::MallocMessageBuilder {
 public:
   MessageBuilder() = default;
+  // build into a caller owned, zeroed first segment. It is zeroed again on destruction, so it can be reused.
+  MessageBuilder(kj::ArrayPtr<capnp::word> first_segment) : capnp::MallocMessageBuilder(first_segment) {}
 
   cereal::Event::Builder initEvent(bool valid = true) {
     cereal::Event::Builder event = initRoot<cereal::Event>();
@@ -135,8 +146,9 @@ private:
 class PubMaster {
 public:
   PubMaster(const std::vector<const char *> &service_list);
-  inline int send(const char *name, capnp::byte *data, size_t size) { return sockets_.at(name)->send((char *)data, size); }
+  int send(const char *name, capnp::byte *data, size_t size);
   int send(const char *name, MessageBuilder &msg);
+  int sendBatch(const char *name, const std::vector<kj::ArrayPtr<capnp::byte>> &msgs);
   ~PubMaster();
 
 private:
@@ -4,6 +4,7 @@
 from libcpp.string cimport string
 from libcpp.vector cimport vector
 from libcpp cimport bool
+from libc.stdint cimport uint32_t, uint64_t
 
 
 cdef extern from "cereal/messaging/impl_fake.h":
@@ -66,3 +67,12 @@ cdef extern from "cereal/messaging/messaging.h":
     Poller * create()
     void registerSocket(SubSocket *)
     vector[SubSocket*] poll(int) nogil
+
+
+cdef extern from "cereal/messaging/trace.h":
+  cdef enum PubSubTraceType:
+    PUBSUB_TRACE_SEND
+    PUBSUB_TRACE_RECV
+
+  const bool PUBSUB_TRACE_ENABLED
+  void pubsub_trace(PubSubTraceType, const char *, uint64_t, size_t, uint32_t)
@@ -5,6 +5,7 @@ import sys
 from libcpp.string cimport string
 from libcpp.vector cimport vector
 from libcpp cimport bool
+from libc.stdint cimport uint64_t
 from libc cimport errno
 from libc.string cimport strerror
 from cython.operator import dereference
@@ -16,6 +17,7 @@ from .messaging cimport PubSocket as cppPubSocket
 from .messaging cimport Poller as cppPoller
 from .messaging cimport Message as cppMessage
 from .messaging cimport Event as cppEvent, SocketEventHandle as cppSocketEventHandle
+from .messaging cimport PUBSUB_TRACE_ENABLED, PUBSUB_TRACE_SEND, PUBSUB_TRACE_RECV, pubsub_trace
 
 
 class MessagingError(Exception):
@@ -45,6 +47,18 @@ def delete_fake_prefix():
   cppSocketEventHandle.set_fake_prefix(b"")
 
 
+def pubsub_trace_enabled():
+  return PUBSUB_TRACE_ENABLED
+
+
+def trace_send(string name, uint64_t log_mono_time, size_t size):
+  pubsub_trace(PUBSUB_TRACE_SEND, name.c_str(), log_mono_time, size, 1)
+
+
+def trace_recv(string name, uint64_t log_mono_time, size_t size):
+  pubsub_trace(PUBSUB_TRACE_RECV, name.c_str(), log_mono_time, size, 1)
+
+
 def wait_for_one_event(list events, int timeout=-1):
   cdef vector[cppEvent] items
   for event in events:
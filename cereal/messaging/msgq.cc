@@ -11,6 +11,7 @@
 #include <random>
 #include <string>
 #include <limits>
+#include <climits>
 
 #include <poll.h>
 #include <sys/ioctl.h>
@@ -19,16 +20,15 @@
 #include <sys/types.h>
 #include <sys/syscall.h>
 #include <fcntl.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#endif
 #include <unistd.h>
 
 #include <stdio.h>
 
 #include "cereal/messaging/msgq.h"
 
-void sigusr2_handler(int signal) {
-  assert(signal == SIGUSR2);
-}
-
 uint64_t msgq_get_uid(void){
   std::random_device rd("/dev/urandom");
   std::uniform_int_distribution<uint64_t> distribution(0, std::numeric_limits<uint32_t>::max());
@@ -43,6 +43,114 @@ uint64_t msgq_get_uid(void){
   return uid;
 }
 
+// Whether the thread that created the uid still exists
+static bool msgq_uid_alive(uint64_t uid){
+  return kill(uid & 0xFFFFFFFF, 0) == 0 || errno != ESRCH;
+}
+
+static std::string msgq_shm_path(const char * path){
+  std::string full_path = "/dev/shm/";
+  const char* prefix = std::getenv("OPENPILOT_PREFIX");
+  if (prefix) {
+    full_path += std::string(prefix) + "/";
+  }
+  return full_path + path;
+}
+
+static msgq_wake_slot_t * msgq_wake_table(){
+  static msgq_wake_slot_t * table = []() -> msgq_wake_slot_t * {
+    size_t size = NUM_WAKE_SLOTS * sizeof(msgq_wake_slot_t);
+    std::string full_path = msgq_shm_path("msgq_wake");
+
+    auto fd = open(full_path.c_str(), O_RDWR | O_CREAT, 0664);
+    if (fd < 0) {
+      std::cout << "Warning, could not open: " << full_path << std::endl;
+      return NULL;
+    }
+
+    int rc = ftruncate(fd, size);
+    char * mem = (rc < 0) ? (char*)MAP_FAILED : (char*)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    return (mem == MAP_FAILED) ? NULL : (msgq_wake_slot_t *)mem;
+  }();
+  return table;
+}
+
+static uint64_t msgq_alloc_wake_slot(msgq_wake_slot_t * table){
+  uint64_t uid = msgq_get_uid();
+
+  // First look for a free slot, then reclaim slots of threads that exited without releasing theirs
+  for (int pass = 0; pass < 2; pass++){
+    for (size_t i = 0; i < NUM_WAKE_SLOTS; i++){
+      uint64_t owner = table[i].owner;
+      if (owner != 0 && (pass == 0 || msgq_uid_alive(owner))){
+        continue;
+      }
+      if (table[i].owner.compare_exchange_strong(owner, uid)){
+        return i + 1;
+      }
+    }
+  }
+
+  std::cout << "Warning, no msgq wake slots left, falling back to polling" << std::endl;
+  return 0;
+}
+
+struct msgq_thread_wake_slot {
+  uint64_t slot = 0; // index + 1, 0 if unavailable
+  bool allocated = false;
+
+  ~msgq_thread_wake_slot(){
+    msgq_wake_slot_t * table = msgq_wake_table();
+    if (slot != 0 && table != NULL){
+      table[slot - 1].owner = 0;
+    }
+  }
+};
+
+// Wake slot of the calling thread, allocated on first use and released on thread exit
+static uint64_t msgq_get_wake_slot(void){
+  static thread_local msgq_thread_wake_slot s;
+  if (!s.allocated){
+    msgq_wake_slot_t * table = msgq_wake_table();
+    s.slot = (table != NULL) ? msgq_alloc_wake_slot(table) : 0;
+    s.allocated = true;
+  }
+  return s.slot;
+}
+
+static void msgq_wake(uint64_t slot){
+  msgq_wake_slot_t * table = msgq_wake_table();
+  if (slot == 0 || slot > NUM_WAKE_SLOTS || table == NULL){
+    return;
+  }
+
+  msgq_wake_slot_t * s = &table[slot - 1];
+  s->seq++;
+  if (s->waiting){
+  #ifdef __linux__
+    syscall(SYS_futex, &s->seq, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+  #endif
+  }
+}
+
+static void msgq_wait(msgq_wake_slot_t * s, uint32_t seq, int ms){
+  struct timespec ts;
+  ts.tv_sec = ms / 1000;
+  ts.tv_nsec = (ms % 1000) * 1000 * 1000;
+
+  #ifdef __linux__
+    if (s != NULL){
+      syscall(SYS_futex, &s->seq, FUTEX_WAIT, seq, &ts, NULL, 0);
+      return;
+    }
+  #else
+    UNUSED(s);
+    UNUSED(seq);
+  #endif
+  nanosleep(&ts, NULL);
+}
+
 int msgq_msg_init_size(msgq_msg_t * msg, size_t size){
   msg->size = size;
   msg->data = new(std::nothrow) char[size];
@@ -72,9 +180,77 @@ int msgq_msg_close(msgq_msg_t * msg){
 void msgq_reset_reader(msgq_queue_t * q){
   int id = q->reader_id;
   q->read_valids[id]->store(true);
+  q->read_counts[id]->store(*q->write_count);
   q->read_pointers[id]->store(*q->write_pointer);
 }
 
+static uint64_t msgq_reader_slots(msgq_queue_t *q){
+  uint64_t reader_slots = *q->reader_slots;
+  return (reader_slots == 0) ? NUM_READERS : std::min<uint64_t>(reader_slots, MAX_READERS);
+}
+
+static uint64_t msgq_bytes_behind(msgq_queue_t *q, uint64_t i){
+  if (!*q->read_valids[i]){
+    return q->size;
+  }
+
+  uint32_t read_cycles, read_pointer;
+  UNPACK64(read_cycles, read_pointer, *q->read_pointers[i]);
+
+  uint32_t write_cycles, write_pointer;
+  UNPACK64(write_cycles, write_pointer, *q->write_pointer);
+
+  if (read_cycles == write_cycles){
+    return (write_pointer >= read_pointer) ? write_pointer - read_pointer : 0;
+  }
+  return (q->size - read_pointer) + write_pointer;
+}
+
+static void msgq_invalidate_reader(msgq_queue_t *q, uint64_t i){
+  if (q->read_valids[i]->exchange(false)){
+    (*q->read_invalidations[i])++;
+  }
+}
+
+// Takes over a free reader slot
+static bool msgq_claim_reader(msgq_queue_t *q, uint64_t i, uint64_t uid){
+  uint64_t free_uid = 0;
+  if (!q->read_uids[i]->compare_exchange_strong(free_uid, uid)){
+    return false;
+  }
+
+  // We start with read_valid = false,
+  // on the first read the read pointer will be synchronized with the write pointer
+  *q->read_valids[i] = false;
+  *q->read_pointers[i] = 0;
+  *q->read_invalidations[i] = 0;
+  return true;
+}
+
+// Frees the slot of a reader whose thread is gone
+static void msgq_evict_reader(msgq_queue_t *q, uint64_t i, uint64_t uid){
+  *q->read_valids[i] = false;
+  q->read_uids[i]->compare_exchange_strong(uid, 0);
+}
+
+// All slots are taken. Free the slots of readers whose thread is gone, live readers keep theirs.
+// Returns false if every slot still belongs to a live reader
+static bool msgq_reclaim_readers(msgq_queue_t *q){
+  uint64_t num_readers = std::min<uint64_t>(*q->num_readers, MAX_READERS);
+  bool reclaimed = false;
+
+  for (uint64_t i = 0; i < num_readers; i++){
+    uint64_t uid = *q->read_uids[i];
+    if (uid == 0){
+      reclaimed = true;
+    } else if (!msgq_uid_alive(uid)){
+      msgq_evict_reader(q, i, uid);
+      reclaimed = true;
+    }
+  }
+  return reclaimed;
+}
+
 void msgq_wait_for_subscriber(msgq_queue_t *q){
   while (*q->num_readers == 0){
     // wait for subscriber
@@ -83,16 +259,49 @@ void msgq_wait_for_subscriber(msgq_queue_t *q){
   return;
 }
 
+static bool msgq_env_flag(const char * name){
+  const char * value = std::getenv(name);
+  return value != NULL && value[0] != '\0' && strcmp(value, "0") != 0;
+}
+
+// Optionally back the segment with transparent hugepages, fault it in up front, and lock it in RAM,
+// so the first laps of the ring don't page fault on the hot path. All of them commit the whole segment.
+// Hugepages on shm need /sys/kernel/mm/transparent_hugepage/shmem_enabled set to advise
+static void msgq_commit_memory(char * mem, size_t size){
+  static const bool hugepages = msgq_env_flag("MSGQ_HUGEPAGES");
+  static const bool prefault = msgq_env_flag("MSGQ_PREFAULT");
+  static const bool lock = msgq_env_flag("MSGQ_MLOCK");
+
+#ifdef MADV_HUGEPAGE
+  if (hugepages && madvise(mem, size, MADV_HUGEPAGE) != 0){
+    std::cout << "Warning, madvise(MADV_HUGEPAGE) failed: " << strerror(errno) << std::endl;
+  }
+#else
+  UNUSED(hugepages);
+#endif
+
+  // Not MAP_POPULATE, that would fault the pages in before the hugepage advice.
+  // Reading allocates the shm pages without touching data another process may be writing
+  if (prefault){
+    const size_t page_size = sysconf(_SC_PAGESIZE);
+    for (size_t i = 0; i < size; i += page_size){
+      (void)*(volatile char *)(mem + i);
+    }
+  }
+
+  if (lock && mlock(mem, size) != 0){
+    std::cout << "Warning, mlock failed: " << strerror(errno) << std::endl;
+  }
+}
+
 int msgq_new_queue(msgq_queue_t * q, const char * path, size_t size){
   assert(size < 0xFFFFFFFF); // Buffer must be smaller than 2^32 bytes
-  std::signal(SIGUSR2, sigusr2_handler);
 
-  std::string full_path = "/dev/shm/";
-  const char* prefix = std::getenv("OPENPILOT_PREFIX");
-  if (prefix) {
-    full_path += std::string(prefix) + "/";
-  }
-  full_path += path;
+  // Safe to close even if opening fails
+  q->mmap_p = NULL;
+  q->reader_id = -1;
+
+  std::string full_path = msgq_shm_path(path);
 
   auto fd = open(full_path.c_str(), O_RDWR | O_CREAT, 0664);
   if (fd < 0) {
@@ -108,27 +317,32 @@ int msgq_new_queue(msgq_queue_t * q, const char * path, size_t size){
   char * mem = (char*)mmap(NULL, size + sizeof(msgq_header_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
   close(fd);
 
-  if (mem == NULL){
+  if (mem == MAP_FAILED){
     return -1;
   }
+  msgq_commit_memory(mem, size + sizeof(msgq_header_t));
   q->mmap_p = mem;
 
   msgq_header_t *header = (msgq_header_t *)mem;
 
   // Setup pointers to header segment
   q->num_readers = reinterpret_cast<std::atomic<uint64_t>*>(&header->num_readers);
+  q->reader_slots = reinterpret_cast<std::atomic<uint64_t>*>(&header->reader_slots);
   q->write_pointer = reinterpret_cast<std::atomic<uint64_t>*>(&header->write_pointer);
   q->write_uid = reinterpret_cast<std::atomic<uint64_t>*>(&header->write_uid);
+  q->write_count = reinterpret_cast<std::atomic<uint64_t>*>(&header->write_count);
 
-  for (size_t i = 0; i < NUM_READERS; i++){
+  for (size_t i = 0; i < MAX_READERS; i++){
     q->read_pointers[i] = reinterpret_cast<std::atomic<uint64_t>*>(&header->read_pointers[i]);
     q->read_valids[i] = reinterpret_cast<std::atomic<uint64_t>*>(&header->read_valids[i]);
     q->read_uids[i] = reinterpret_cast<std::atomic<uint64_t>*>(&header->read_uids[i]);
+    q->read_wake_slots[i] = reinterpret_cast<std::atomic<uint64_t>*>(&header->read_wake_slots[i]);
+    q->read_counts[i] = reinterpret_cast<std::atomic<uint64_t>*>(&header->read_counts[i]);
+    q->read_invalidations[i] = reinterpret_cast<std::atomic<uint64_t>*>(&header->read_invalidations[i]);
   }
 
   q->data = mem + sizeof(msgq_header_t);
   q->size = size;
-  q->reader_id = -1;
 
   q->endpoint = path;
   q->read_conflate = false;
@@ -137,87 +351,95 @@ int msgq_new_queue(msgq_queue_t * q, const char * path, size_t size){
 }
 
 void msgq_close_queue(msgq_queue_t *q){
+  // Free our reader slot, unless a publisher already evicted us and gave it to someone else
+  if (q->mmap_p != NULL && q->reader_id >= 0){
+    uint64_t uid = q->read_uid_local;
+    q->read_uids[q->reader_id]->compare_exchange_strong(uid, 0);
+  }
+
   if (q->mmap_p != NULL){
     munmap(q->mmap_p, q->size + sizeof(msgq_header_t));
   }
 }
 
 
-void msgq_init_publisher(msgq_queue_t * q) {
+void msgq_init_publisher(msgq_queue_t * q, size_t reader_slots) {
   //std::cout << "Starting publisher" << std::endl;
+  assert(reader_slots > 0 && reader_slots <= MAX_READERS);
   uint64_t uid = msgq_get_uid();
 
   *q->write_uid = uid;
   *q->num_readers = 0;
+  *q->reader_slots = reader_slots;
+  *q->write_count = 0;
 
-  for (size_t i = 0; i < NUM_READERS; i++){
+  for (size_t i = 0; i < MAX_READERS; i++){
     *q->read_valids[i] = false;
     *q->read_uids[i] = 0;
+    *q->read_wake_slots[i] = 0;
+    *q->read_counts[i] = 0;
+    *q->read_invalidations[i] = 0;
   }
 
   q->write_uid_local = uid;
 }
 
-static void thread_signal(uint32_t tid) {
-  #ifndef SYS_tkill
-    // TODO: this won't work for multithreaded programs
-    kill(tid, SIGUSR2);
-  #else
-    syscall(SYS_tkill, tid, SIGUSR2);
-  #endif
-}
-
-void msgq_init_subscriber(msgq_queue_t * q) {
+int msgq_init_subscriber(msgq_queue_t * q, size_t reader_slots) {
   assert(q != NULL);
   assert(q->num_readers != NULL);
+  assert(reader_slots > 0 && reader_slots <= MAX_READERS);
 
   uint64_t uid = msgq_get_uid();
 
+  // Subscribers that start before the publisher get the same number of slots
+  uint64_t unset = 0;
+  q->reader_slots->compare_exchange_strong(unset, reader_slots);
+
   // Get reader id
   while (true){
     uint64_t cur_num_readers = *q->num_readers;
-    uint64_t new_num_readers = cur_num_readers + 1;
+    int64_t id = -1;
 
-    // No more slots available. Reset all subscribers to kick out inactive ones
-    if (new_num_readers > NUM_READERS){
-      //std::cout << "Warning, evicting all subscribers!" << std::endl;
-      *q->num_readers = 0;
-
-      for (size_t i = 0; i < NUM_READERS; i++){
-        *q->read_valids[i] = false;
-
-        uint64_t old_uid = *q->read_uids[i];
-        *q->read_uids[i] = 0;
+    // Reuse a free slot
+    for (uint64_t i = 0; i < std::min<uint64_t>(cur_num_readers, MAX_READERS) && id < 0; i++){
+      if (msgq_claim_reader(q, i, uid)) id = i;
+    }
 
-        // Wake up reader in case they are in a poll
-        thread_signal(old_uid & 0xFFFFFFFF);
+    // Or add a new one. Use atomic compare and swap to handle race condition
+    // where two subscribers start at the same time
+    if (id < 0 && cur_num_readers < msgq_reader_slots(q)){
+      if (std::atomic_compare_exchange_strong(q->num_readers, &cur_num_readers, cur_num_readers + 1) &&
+          msgq_claim_reader(q, cur_num_readers, uid)){
+        id = cur_num_readers;
+      } else {
+        continue;
       }
-
-      continue;
     }
 
-    // Use atomic compare and swap to handle race condition
-    // where two subscribers start at the same time
-    if (std::atomic_compare_exchange_strong(q->num_readers,
-                                            &cur_num_readers,
-                                            new_num_readers)){
-      q->reader_id = cur_num_readers;
-      q->read_uid_local = uid;
-
-      // We start with read_valid = false,
-      // on the first read the read pointer will be synchronized with the write pointer
-      *q->read_valids[cur_num_readers] = false;
-      *q->read_pointers[cur_num_readers] = 0;
-      *q->read_uids[cur_num_readers] = uid;
-      break;
+    // No more slots available
+    if (id < 0){
+      if (msgq_reclaim_readers(q)) continue;
+      errno = EUSERS;
+      return -1;
     }
+
+    q->reader_id = id;
+    q->read_uid_local = uid;
+    *q->read_wake_slots[id] = msgq_get_wake_slot();
+    break;
   }
 
   //std::cout << "New subscriber id: " << q->reader_id << " uid: " << q->read_uid_local << " " << q->endpoint << std::endl;
   msgq_reset_reader(q);
+  return 0;
 }
 
 int msgq_msg_send(msgq_msg_t * msg, msgq_queue_t *q){
+  int r = msgq_msg_send_batch(msg, 1, q);
+  return (r < 0) ? r : msg->size;
+}
+
+int msgq_msg_send_batch(msgq_msg_t * msgs, size_t count, msgq_queue_t *q){
   // Die if we are no longer the active publisher
   if (q->write_uid_local != *q->write_uid){
     std::cout << "Killing old publisher: " << q->endpoint << std::endl;
@@ -225,80 +447,92 @@ int msgq_msg_send(msgq_msg_t * msg, msgq_queue_t *q){
     return -1;
   }
 
-  uint64_t total_msg_size = ALIGN(msg->size + sizeof(int64_t));
-
-  // We need to fit at least three messages in the queue,
-  // then we can always safely access the last message
-  assert(3 * total_msg_size <= q->size);
-
   uint64_t num_readers = *q->num_readers;
 
   uint32_t write_cycles, write_pointer;
   UNPACK64(write_cycles, write_pointer, *q->write_pointer);
 
-  char *p = q->data + write_pointer; // add base offset
+  size_t i = 0;
+  while (i < count){
+    // Find the run of messages that fits before the end of the buffer
+    uint64_t start = write_pointer;
+    uint64_t end = write_pointer;
+    size_t run_end = i;
+    for (; run_end < count; run_end++){
+      uint64_t total_msg_size = ALIGN(msgs[run_end].size + sizeof(int64_t));
+
+      // We need to fit at least three messages in the queue,
+      // then we can always safely access the last message
+      assert(3 * total_msg_size <= q->size);
+
+      // Check remaining space
+      // Always leave space for a wraparound tag for the next message, including alignment
+      int64_t remaining_space = q->size - end - total_msg_size - sizeof(int64_t);
+      if (remaining_space <= 0){
+        break;
+      }
+      end += total_msg_size;
+    }
 
-  // Check remaining space
-  // Always leave space for a wraparound tag for the next message, including alignment
-  int64_t remaining_space = q->size - write_pointer - total_msg_size - sizeof(int64_t);
-  if (remaining_space <= 0){
-    // Write -1 size tag indicating wraparound
-    *(int64_t*)p = -1;
+    if (run_end == i){
+      // Write -1 size tag indicating wraparound
+      *(int64_t*)(q->data + write_pointer) = -1;
 
-    // Invalidate all readers that are beyond the write pointer
-    // TODO: should we handle the case where a new reader shows up while this is running?
-    for (uint64_t i = 0; i < num_readers; i++){
-      uint64_t read_pointer = *q->read_pointers[i];
-      uint64_t read_cycles = read_pointer >> 32;
-      read_pointer &= 0xFFFFFFFF;
+      // Invalidate all readers that are beyond the write pointer
+      // TODO: should we handle the case where a new reader shows up while this is running?
+      for (uint64_t r = 0; r < num_readers; r++){
+        uint64_t read_pointer = *q->read_pointers[r];
+        uint64_t read_cycles = read_pointer >> 32;
+        read_pointer &= 0xFFFFFFFF;
 
-      if ((read_pointer > write_pointer) && (read_cycles != write_cycles)) {
-        *q->read_valids[i] = false;
+        if ((read_pointer > write_pointer) && (read_cycles != write_cycles)) {
+          msgq_invalidate_reader(q, r);
+        }
       }
+
+      // Update global and local copies of write pointer and write_cycles.
+      // This also publishes the messages of the batch written before the wraparound
+      __sync_synchronize();
+      write_pointer = 0;
+      write_cycles = write_cycles + 1;
+      PACK64(*q->write_pointer, write_cycles, write_pointer);
+      continue;
     }
 
-    // Update global and local copies of write pointer and write_cycles
-    write_pointer = 0;
-    write_cycles = write_cycles + 1;
-    PACK64(*q->write_pointer, write_cycles, write_pointer);
+    // Invalidate readers that are in the area that will be written
+    for (uint64_t r = 0; r < num_readers; r++){
+      uint32_t read_cycles, read_pointer;
+      UNPACK64(read_cycles, read_pointer, *q->read_pointers[r]);
 
-    // Set actual pointer to the beginning of the data segment
-    p = q->data;
-  }
+      if ((read_pointer >= start) && (read_pointer < end) && (read_cycles != write_cycles)) {
+        msgq_invalidate_reader(q, r);
+      }
+    }
 
-  // Invalidate readers that are in the area that will be written
-  uint64_t start = write_pointer;
-  uint64_t end = ALIGN(start + sizeof(int64_t) + msg->size);
+    for (; i < run_end; i++){
+      char *p = q->data + write_pointer; // add base offset
 
-  for (uint64_t i = 0; i < num_readers; i++){
-    uint32_t read_cycles, read_pointer;
-    UNPACK64(read_cycles, read_pointer, *q->read_pointers[i]);
+      // Write size tag
+      std::atomic<int64_t> *size_p = reinterpret_cast<std::atomic<int64_t>*>(p);
+      *size_p = msgs[i].size;
 
-    if ((read_pointer >= start) && (read_pointer < end) && (read_cycles != write_cycles)) {
-      *q->read_valids[i] = false;
+      // Copy data
+      memcpy(p + sizeof(int64_t), msgs[i].data, msgs[i].size);
+      write_pointer = ALIGN(write_pointer + msgs[i].size + sizeof(int64_t));
     }
   }
-
-
-  // Write size tag
-  std::atomic<int64_t> *size_p = reinterpret_cast<std::atomic<int64_t>*>(p);
-  *size_p = msg->size;
-
-  // Copy data
-  memcpy(p + sizeof(int64_t), msg->data, msg->size);
   __sync_synchronize();
 
-  // Update write pointer
-  uint32_t new_ptr = ALIGN(write_pointer + msg->size + sizeof(int64_t));
-  PACK64(*q->write_pointer, write_cycles, new_ptr);
+  // Update write pointer, once for the whole batch
+  PACK64(*q->write_pointer, write_cycles, write_pointer);
+  (*q->write_count) += count;
 
   // Notify readers
-  for (uint64_t i = 0; i < num_readers; i++){
-    uint64_t reader_uid = *q->read_uids[i];
-    thread_signal(reader_uid & 0xFFFFFFFF);
+  for (uint64_t r = 0; r < num_readers; r++){
+    msgq_wake(*q->read_wake_slots[r]);
   }
 
-  return msg->size;
+  return count;
 }
 
 
@@ -309,7 +543,8 @@ int msgq_msg_ready(msgq_queue_t * q){
 
   if (q->read_uid_local != *q->read_uids[id]){
     //std::cout << q->endpoint << ": Reader was evicted, reconnecting" << std::endl;
-    msgq_init_subscriber(q);
+    // The publisher restarted. Until a slot is free there is nothing to read
+    if (msgq_init_subscriber(q) != 0) return 0;
     goto start;
   }
 
@@ -331,14 +566,18 @@ int msgq_msg_ready(msgq_queue_t * q){
   return (read_pointer != write_pointer);
 }
 
-int msgq_msg_recv(msgq_msg_t * msg, msgq_queue_t * q){
+int msgq_msg_borrow(msgq_msg_t * msg, msgq_queue_t * q){
  start:
   int id = q->reader_id;
   assert(id >= 0); // Make sure subscriber is initialized
 
   if (q->read_uid_local != *q->read_uids[id]){
     //std::cout << q->endpoint << ": Reader was evicted, reconnecting" << std::endl;
-    msgq_init_subscriber(q);
+    // The publisher restarted. Until a slot is free there is nothing to read
+    if (msgq_init_subscriber(q) != 0){
+      msg->size = 0;
+      return 0;
+    }
     goto start;
   }
 
@@ -392,77 +631,147 @@ int msgq_msg_recv(msgq_msg_t * msg, msgq_queue_t * q){
     if (new_read_pointer != write_pointer){
       // Update read pointer
       PACK64(*q->read_pointers[id], read_cycles, new_read_pointer);
+      (*q->read_counts[id])++;
       goto start;
     }
   }
 
-  // Copy message
-  if (msgq_msg_init_size(msg, size) < 0)
-    return -1;
+  // Hand out the message in place. The read pointer stays at the start of the message until it is
+  // released, so the writer will invalidate this reader as soon as it starts overwriting it
+  msg->data = p + sizeof(int64_t);
+  msg->size = size;
+  PACK64(q->borrowed_read_pointer, read_cycles, new_read_pointer);
 
-  __sync_synchronize();
-  memcpy(msg->data, p + sizeof(int64_t), size);
+  return msg->size;
+}
+
+int msgq_msg_release(msgq_queue_t * q){
+  int id = q->reader_id;
+  assert(id >= 0); // Make sure subscriber is initialized
   __sync_synchronize();
 
+  // Reader was evicted, the next borrow will reconnect
+  if (q->read_uid_local != *q->read_uids[id]){
+    return -1;
+  }
+
   // Update read pointer
-  PACK64(*q->read_pointers[id], read_cycles, new_read_pointer);
+  *q->read_pointers[id] = q->borrowed_read_pointer;
+  (*q->read_counts[id])++;
 
-  // Check if the actual data that was copied is valid
+  // Check if the data was still valid while it was used
   if (!*q->read_valids[id]){
-    msgq_msg_close(msg);
     msgq_reset_reader(q);
-    goto start;
+    return -1;
   }
 
+  return 0;
+}
+
+int msgq_msg_recv(msgq_msg_t * msg, msgq_queue_t * q){
+  msgq_msg_t borrowed;
+  while (msgq_msg_borrow(&borrowed, q) > 0){
+    // Copy message
+    if (msgq_msg_init_size(msg, borrowed.size) < 0)
+      return -1;
 
-  return msg->size;
+    __sync_synchronize();
+    memcpy(msg->data, borrowed.data, borrowed.size);
+
+    if (msgq_msg_release(q) == 0){
+      return msg->size;
+    }
+
+    // The copied data was overwritten, try again
+    msgq_msg_close(msg);
+  }
+
+  msg->size = 0;
+  return 0;
 }
 
 
 
 int msgq_poll(msgq_pollitem_t * items, size_t nitems, int timeout){
-  int num = 0;
+  uint64_t slot = msgq_get_wake_slot();
+  msgq_wake_slot_t * s = (slot != 0) ? &msgq_wake_table()[slot - 1] : NULL;
 
-  // Check if messages ready
+  // Publishers wake the thread that subscribed, make sure that is the one polling
   for (size_t i = 0; i < nitems; i++) {
-    items[i].revents = msgq_msg_ready(items[i].q);
-    if (items[i].revents) num++;
+    msgq_queue_t * q = items[i].q;
+    if (q->reader_id >= 0 && q->read_uid_local == *q->read_uids[q->reader_id] && *q->read_wake_slots[q->reader_id] != slot){
+      *q->read_wake_slots[q->reader_id] = slot;
+    }
   }
 
-  int ms = (timeout == -1) ? 100 : timeout;
-  struct timespec ts;
-  ts.tv_sec = ms / 1000;
-  ts.tv_nsec = (ms % 1000) * 1000 * 1000;
-
-
-  while (num == 0) {
-    int ret;
+  auto start = std::chrono::steady_clock::now();
+  int num = 0;
 
-    ret = nanosleep(&ts, &ts);
+  while (true) {
+    // Publishers bump seq after the write pointer, so a message that arrives
+    // after the ready check below makes the futex wait return immediately
+    if (s != NULL) s->waiting = 1;
+    uint32_t seq = (s != NULL) ? (uint32_t)s->seq : 0;
 
     // Check if messages ready
     for (size_t i = 0; i < nitems; i++) {
-      if (items[i].revents == 0 && msgq_msg_ready(items[i].q)){
-        num += 1;
-        items[i].revents = 1;
-      }
+      items[i].revents = msgq_msg_ready(items[i].q);
+      if (items[i].revents) num++;
     }
 
-    // exit if we had a timeout and the sleep finished
-    if (timeout != -1 && ret == 0){
+    if (num > 0 || timeout == 0){
       break;
     }
+
+    // Wait at most 100 ms at a time, in case a wakeup went to a stale slot. Without a slot fall back to polling
+    int ms = (s != NULL) ? 100 : 1;
+    if (timeout != -1){
+      auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+      int remaining = timeout - (int)elapsed.count();
+      if (remaining <= 0){
+        break;
+      }
+      ms = std::min(ms, remaining);
+    }
+
+    msgq_wait(s, seq, ms);
   }
 
+  if (s != NULL) s->waiting = 0;
   return num;
 }
 
 bool msgq_all_readers_updated(msgq_queue_t *q) {
-  uint64_t num_readers = *q->num_readers;
+  uint64_t num_readers = std::min<uint64_t>(*q->num_readers, MAX_READERS);
+  bool any_readers = false;
   for (uint64_t i = 0; i < num_readers; i++) {
+    if (*q->read_uids[i] == 0) continue;
+
+    any_readers = true;
     if (*q->read_valids[i] && *q->write_pointer != *q->read_pointers[i]) {
       return false;
     }
   }
-  return num_readers > 0;
+  return any_readers;
+}
+
+size_t msgq_get_reader_stats(msgq_queue_t *q, msgq_reader_stats_t *stats, size_t max_stats) {
+  uint64_t num_readers = std::min<uint64_t>(*q->num_readers, MAX_READERS);
+  uint64_t write_count = *q->write_count;
+
+  size_t n = 0;
+  for (uint64_t i = 0; i < num_readers && n < max_stats; i++) {
+    uint64_t uid = *q->read_uids[i];
+    if (uid == 0) continue;
+
+    uint64_t read_count = *q->read_counts[i];
+    msgq_reader_stats_t &s = stats[n++];
+    s.reader_id = i;
+    s.uid = uid;
+    s.valid = *q->read_valids[i];
+    s.bytes_behind = msgq_bytes_behind(q, i);
+    s.msgs_behind = (write_count > read_count) ? write_count - read_count : 0;
+    s.invalidations = *q->read_invalidations[i];
+  }
+  return n;
 }
@@ -7,6 +7,8 @@
 
 #define DEFAULT_SEGMENT_SIZE (10 * 1024 * 1024)
 #define NUM_READERS 12
+#define MAX_READERS 64
+#define NUM_WAKE_SLOTS 1024
 #define ALIGN(n) ((n + (8 - 1)) & -8)
 
 #define UNUSED(x) (void)x
@@ -14,27 +16,47 @@
 #define PACK64(output, higher, lower) output = ((uint64_t)higher << 32) | ((uint64_t)lower & 0xFFFFFFFF)
 
 struct  msgq_header_t {
-  uint64_t num_readers;
+  uint64_t num_readers; // reader slots in use are below this, free slots have a zero uid
+  uint64_t reader_slots; // max number of readers, set by the publisher or the first subscriber
   uint64_t write_pointer;
   uint64_t write_uid;
-  uint64_t read_pointers[NUM_READERS];
-  uint64_t read_valids[NUM_READERS];
-  uint64_t read_uids[NUM_READERS];
+  uint64_t write_count;
+  uint64_t read_pointers[MAX_READERS];
+  uint64_t read_valids[MAX_READERS];
+  uint64_t read_uids[MAX_READERS];
+  uint64_t read_wake_slots[MAX_READERS];
+  uint64_t read_counts[MAX_READERS];
+  uint64_t read_invalidations[MAX_READERS];
+};
+
+// Futex word a thread blocks on in msgq_poll. One per waiting thread, in a table shared by all processes.
+// Publishers bump seq for every reader they wrote to, and only do the FUTEX_WAKE syscall if someone is waiting
+struct msgq_wake_slot_t {
+  std::atomic<uint32_t> seq;
+  std::atomic<uint32_t> waiting;
+  std::atomic<uint64_t> owner;
+  char padding[48];
 };
 
 struct msgq_queue_t {
   std::atomic<uint64_t> *num_readers;
+  std::atomic<uint64_t> *reader_slots;
   std::atomic<uint64_t> *write_pointer;
   std::atomic<uint64_t> *write_uid;
-  std::atomic<uint64_t> *read_pointers[NUM_READERS];
-  std::atomic<uint64_t> *read_valids[NUM_READERS];
-  std::atomic<uint64_t> *read_uids[NUM_READERS];
+  std::atomic<uint64_t> *write_count;
+  std::atomic<uint64_t> *read_pointers[MAX_READERS];
+  std::atomic<uint64_t> *read_valids[MAX_READERS];
+  std::atomic<uint64_t> *read_uids[MAX_READERS];
+  std::atomic<uint64_t> *read_wake_slots[MAX_READERS];
+  std::atomic<uint64_t> *read_counts[MAX_READERS];
+  std::atomic<uint64_t> *read_invalidations[MAX_READERS];
   char * mmap_p;
   char * data;
   size_t size;
   int reader_id;
   uint64_t read_uid_local;
   uint64_t write_uid_local;
+  uint64_t borrowed_read_pointer;
 
   bool read_conflate;
   std::string endpoint;
@@ -50,6 +72,15 @@ struct msgq_pollitem_t {
   int revents;
 };
 
+struct msgq_reader_stats_t {
+  int reader_id;
+  uint64_t uid; // thread id in the lower 32 bits
+  bool valid;
+  uint64_t bytes_behind; // the whole ring if the reader was lapped
+  uint64_t msgs_behind;
+  uint64_t invalidations; // times the writer lapped this reader
+};
+
 void msgq_wait_for_subscriber(msgq_queue_t *q);
 void msgq_reset_reader(msgq_queue_t *q);
 
@@ -59,12 +90,24 @@ int msgq_msg_close(msgq_msg_t *msg);
 
 int msgq_new_queue(msgq_queue_t * q, const char * path, size_t size);
 void msgq_close_queue(msgq_queue_t *q);
-void msgq_init_publisher(msgq_queue_t * q);
-void msgq_init_subscriber(msgq_queue_t * q);
+void msgq_init_publisher(msgq_queue_t * q, size_t reader_slots = NUM_READERS);
+// reader_slots is used until a publisher sets it. Returns -1 with errno EUSERS if all reader slots belong to live readers
+int msgq_init_subscriber(msgq_queue_t * q, size_t reader_slots = NUM_READERS);
 
 int msgq_msg_send(msgq_msg_t *msg, msgq_queue_t *q);
+// Writes all messages with a single write pointer update and reader wakeup. Returns the number of messages sent
+int msgq_msg_send_batch(msgq_msg_t *msgs, size_t count, msgq_queue_t *q);
 int msgq_msg_recv(msgq_msg_t *msg, msgq_queue_t *q);
+
+// Zero-copy receive. msgq_msg_borrow points msg into the shared ring without advancing the reader,
+// msgq_msg_release advances it and returns -1 if the writer lapped the reader while the data was in use.
+// A borrowed message must not be closed, and is only valid until the next borrow/recv on the queue.
+int msgq_msg_borrow(msgq_msg_t *msg, msgq_queue_t *q);
+int msgq_msg_release(msgq_queue_t *q);
 int msgq_msg_ready(msgq_queue_t * q);
 int msgq_poll(msgq_pollitem_t * items, size_t nitems, int timeout);
 
 bool msgq_all_readers_updated(msgq_queue_t *q);
+
+// Read-only snapshot of the active readers of a queue, works without subscribing. Returns the number of readers filled in
+size_t msgq_get_reader_stats(msgq_queue_t *q, msgq_reader_stats_t *stats, size_t max_stats);
@@ -0,0 +1,201 @@
+// Publish-to-receive latency and throughput of msgq.
+// Latency compares the futex wakeup in msgq_poll against the old scheme, where the publisher
+// sent SIGUSR2 to every reader thread and readers slept in nanosleep between checks.
+// Throughput compares msgq_msg_send against msgq_msg_send_batch for 1, 4 and 12 readers, with the
+// publisher throttled on the slowest reader so the rate is what the readers keep up with.
+// Exits with an error if any run delivers less than MIN_DELIVERY of the messages sent.
+//
+// usage: msgq_benchmark [messages]
+
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cereal/messaging/msgq.h"
+
+const size_t MSG_SIZE = 1024;
+const size_t SEGMENT_SIZE = 1024 * 1024;
+const size_t BATCH_SIZE = 16;
+// the publisher waits while a reader is this many messages behind, a quarter of the ring
+const uint64_t MAX_READER_LAG = SEGMENT_SIZE / (MSG_SIZE + sizeof(int64_t)) / 4;
+const double MIN_DELIVERY = 0.99;
+
+struct bench_msg_t {
+  uint64_t send_nanos;
+  uint64_t done;
+};
+
+static uint64_t nanos_now() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+static void sigusr2_handler(int signal) {
+  (void)signal;
+}
+
+struct Reader {
+  std::thread thread;
+  std::atomic<pid_t> tid{0};
+  std::vector<uint64_t> latencies;
+  uint64_t last_recv_nanos = 0;
+};
+
+static void reader_thread(Reader *r, const std::string &endpoint, bool use_signals, std::atomic<int> *ready, std::atomic<int> *finished) {
+  r->tid = syscall(SYS_gettid);
+
+  msgq_queue_t q;
+  msgq_new_queue(&q, endpoint.c_str(), SEGMENT_SIZE);
+  msgq_init_subscriber(&q);
+  (*ready)++;
+
+  while (true) {
+    if (use_signals) {
+      // old msgq_poll: sleep until the publisher's signal interrupts us
+      struct timespec ts = {0, 100 * 1000 * 1000};
+      while (!msgq_msg_ready(&q)) {
+        nanosleep(&ts, &ts);
+      }
+    } else {
+      msgq_pollitem_t item = {&q, 0};
+      if (msgq_poll(&item, 1, 100) == 0) continue;
+    }
+
+    msgq_msg_t msg;
+    bool done = false;
+    while (msgq_msg_recv(&msg, &q) > 0) {
+      bench_msg_t *m = (bench_msg_t *)msg.data;
+      if (m->done) {
+        done = true;
+      } else {
+        r->last_recv_nanos = nanos_now();
+        r->latencies.push_back(r->last_recv_nanos - m->send_nanos);
+      }
+      msgq_msg_close(&msg);
+    }
+    if (done) break;
+  }
+  msgq_close_queue(&q);
+  (*finished)++;
+}
+
+static uint64_t percentile(std::vector<uint64_t> &v, double p) {
+  if (v.empty()) return 0;
+  size_t idx = std::min(v.size() - 1, (size_t)(p * v.size()));
+  std::nth_element(v.begin(), v.begin() + idx, v.end());
+  return v[idx];
+}
+
+static bool run(const char *name, bool use_signals, int count, bool paced, int num_readers = NUM_READERS, size_t batch_size = 1) {
+  std::string endpoint = std::string("msgq_benchmark_") + (use_signals ? "signal" : "futex");
+
+  msgq_queue_t pub;
+  msgq_new_queue(&pub, endpoint.c_str(), SEGMENT_SIZE);
+  msgq_init_publisher(&pub);
+
+  std::atomic<int> ready{0}, finished{0};
+  std::vector<Reader> readers(num_readers);
+  for (auto &r : readers) {
+    r.thread = std::thread(reader_thread, &r, endpoint, use_signals, &ready, &finished);
+  }
+  while (ready < num_readers) usleep(1000);
+
+  std::vector<char> buf(MSG_SIZE * batch_size);
+  std::vector<msgq_msg_t> msgs(batch_size);
+  for (size_t i = 0; i < batch_size; i++) {
+    msgs[i] = {MSG_SIZE, buf.data() + i * MSG_SIZE};
+  }
+
+  // a reader that falls a whole ring behind gets lapped and loses messages
+  auto wait_for_readers = [&]() {
+    msgq_reader_stats_t stats[MAX_READERS];
+    while (true) {
+      size_t n = msgq_get_reader_stats(&pub, stats, MAX_READERS);
+      uint64_t lag = 0;
+      for (size_t i = 0; i < n; i++) lag = std::max(lag, stats[i].msgs_behind);
+      if (lag + batch_size <= MAX_READER_LAG) return;
+      std::this_thread::yield();
+    }
+  };
+
+  auto send = [&](bool done) {
+    uint64_t ts = nanos_now();
+    for (auto &msg : msgs) {
+      *(bench_msg_t *)msg.data = {ts, done};
+    }
+    if (batch_size == 1) {
+      msgq_msg_send(&msgs[0], &pub);
+    } else {
+      msgq_msg_send_batch(msgs.data(), msgs.size(), &pub);
+    }
+    if (use_signals) {
+      for (auto &r : readers) syscall(SYS_tkill, r.tid.load(), SIGUSR2);
+    }
+  };
+
+  uint64_t start = nanos_now();
+  for (int i = 0; i < count; i += batch_size) {
+    wait_for_readers();
+    send(false);
+    if (paced) usleep(1000);
+  }
+
+  // tell the readers to stop, until all of them got it
+  while (finished < num_readers) {
+    send(true);
+    usleep(1000);
+  }
+  for (auto &r : readers) r.thread.join();
+  msgq_close_queue(&pub);
+
+  std::vector<uint64_t> all;
+  uint64_t last_recv = start;
+  for (auto &r : readers) {
+    all.insert(all.end(), r.latencies.begin(), r.latencies.end());
+    last_recv = std::max(last_recv, r.last_recv_nanos);
+  }
+  size_t received = all.size();
+  uint64_t p50 = percentile(all, 0.5), p99 = percentile(all, 0.99), max = percentile(all, 1.0);
+
+  size_t sent = ((count + batch_size - 1) / batch_size) * batch_size;
+  size_t expected = sent * num_readers;
+  if (paced) {
+    printf("%-8s %2d readers  latency  %zu/%zu received  p50 %7.1f us  p99 %7.1f us  max %8.1f us\n", name,
+           num_readers, received, expected, p50 / 1e3, p99 / 1e3, max / 1e3);
+  } else {
+    double seconds = std::max(last_recv - start, (uint64_t)1) * 1e-9;
+    printf("%-8s %2d readers  batch %2zu  %9.0f msgs/s delivered  %zu/%zu received\n", name,
+           num_readers, batch_size, received / seconds, received, expected);
+  }
+
+  if (received < MIN_DELIVERY * expected) {
+    printf("FAIL: %s delivered %.1f%% of the messages\n", name, 100.0 * received / expected);
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  int count = argc > 1 ? atoi(argv[1]) : 2000;
+  std::signal(SIGUSR2, sigusr2_handler);
+
+  printf("%zu byte messages\n", MSG_SIZE);
+  bool ok = run("signal", true, count, true);
+  ok &= run("futex", false, count, true);
+  ok &= run("signal", true, count * 10, false);
+  for (int num_readers : {1, 4, NUM_READERS}) {
+    ok &= run("futex", false, count * 10, false, num_readers);
+    ok &= run("futex", false, count * 10, false, num_readers, BATCH_SIZE);
+  }
+  return ok ? 0 : 1;
+}
@@ -1,11 +1,15 @@
 #include <time.h>
 #include <assert.h>
 #include <stdlib.h>
+#include <algorithm>
+#include <deque>
 #include <string>
 #include <mutex>
+#include <optional>
 
 #include "cereal/services.h"
 #include "cereal/messaging/messaging.h"
+#include "cereal/messaging/trace.h"
 
 const bool SIMULATION = (getenv("SIMULATION") != nullptr) && (std::string(getenv("SIMULATION")) == "1");
 
@@ -46,18 +50,35 @@ struct SubMaster::SubMessage {
   void *allocated_msg_reader = nullptr;
   bool is_polled = false;
   capnp::FlatArrayMessageReader *msg_reader = nullptr;
-  AlignedBuffer aligned_buf;
+  // event points into one buffer while the next message is received into the other,
+  // so a receive that comes back empty never clobbers the last event
+  AlignedBuffer aligned_buf[2];
+  int next_buf = 0;
   cereal::Event::Reader event;
+
+  // drained services receive every pending message into its own slot.
+  // event_slot holds the latest event and is kept until a newer message arrives
+  struct DrainSlot {
+    AlignedBuffer aligned_buf;
+    std::optional<capnp::FlatArrayMessageReader> msg_reader;
+  };
+  bool drain = false;
+  size_t max_drain = 0;
+  std::deque<DrainSlot> drain_slots;
+  size_t event_slot = SIZE_MAX;
+  std::vector<cereal::Event::Reader> drained;
 };
 
 SubMaster::SubMaster(const std::vector<const char *> &service_list, const std::vector<const char *> &poll,
-                     const char *address, const std::vector<const char *> &ignore_alive) {
+                     const char *address, const std::vector<const char *> &ignore_alive,
+                     const std::vector<const char *> &drain) {
   poller_ = Poller::create();
   for (auto name : service_list) {
     assert(services.count(std::string(name)) > 0);
 
     service serv = services.at(std::string(name));
-    SubSocket *socket = SubSocket::create(message_context.context(), name, address ? address : "127.0.0.1", true);
+    bool is_drained = inList(drain, name);
+    SubSocket *socket = SubSocket::create(message_context.context(), name, address ? address : "127.0.0.1", !is_drained);
     assert(socket != 0);
     bool is_polled = inList(poll, name) || poll.empty();
     if (is_polled) poller_->registerSocket(socket);
@@ -67,7 +88,11 @@ SubMaster::SubMaster(const std::vector<const char *> &service_list, const std::v
       .freq = serv.frequency,
       .ignore_alive = inList(ignore_alive, name),
       .allocated_msg_reader = malloc(sizeof(capnp::FlatArrayMessageReader)),
-      .is_polled = is_polled};
+      .is_polled = is_polled,
+      .drain = is_drained,
+      // a second of messages per update. the rest stay in the queue for the next update, so a publisher
+      // faster than the reader can't keep update() from returning or grow drain_slots without bound
+      .max_drain = (size_t)std::max(serv.frequency, 10)};
     m->msg_reader = new (m->allocated_msg_reader) capnp::FlatArrayMessageReader({});
     messages_[socket] = m;
     services_[name] = m;
@@ -90,18 +115,43 @@ void SubMaster::update(int timeout) {
 
   std::vector<std::pair<std::string, cereal::Event::Reader>> messages;
 
-  for (auto s : sockets) {
-    Message *msg = s->receive(true);
-    if (msg == nullptr) continue;
+  capnp::ReaderOptions options;
+  options.traversalLimitInWords = kj::maxValue; // Don't limit
 
+  for (auto s : sockets) {
     SubMessage *m = messages_.at(s);
+    if (m->drain) {
+      size_t slot = 0;
+      uint32_t drain_index = 0;
+      while (drain_index < m->max_drain) {
+        if (slot == m->event_slot) slot++;
+        if (slot == m->drain_slots.size()) m->drain_slots.emplace_back();
+
+        auto &ds = m->drain_slots[slot];
+        auto words = s->receiveAligned(ds.aligned_buf, true);
+        if (words.size() == 0) break;
+
+        ds.msg_reader.emplace(words, options);
+        messages.push_back({m->name, ds.msg_reader->getRoot<cereal::Event>()});
+        m->event_slot = slot++;
+        ++drain_index;
+        if (PUBSUB_TRACE_ENABLED) {
+          pubsub_trace(PUBSUB_TRACE_RECV, m->name.c_str(), messages.back().second.getLogMonoTime(), words.size() * sizeof(capnp::word), drain_index);
+        }
+      }
+      continue;
+    }
+
+    auto words = s->receiveAligned(m->aligned_buf[m->next_buf], true);
+    if (words.size() == 0) continue;
 
     m->msg_reader->~FlatArrayMessageReader();
-    capnp::ReaderOptions options;
-    options.traversalLimitInWords = kj::maxValue; // Don't limit
-    m->msg_reader = new (m->allocated_msg_reader) capnp::FlatArrayMessageReader(m->aligned_buf.align(msg), options);
-    delete msg;
+    m->msg_reader = new (m->allocated_msg_reader) capnp::FlatArrayMessageReader(words, options);
+    m->next_buf ^= 1;
     messages.push_back({m->name, m->msg_reader->getRoot<cereal::Event>()});
+    if (PUBSUB_TRACE_ENABLED) {
+      pubsub_trace(PUBSUB_TRACE_RECV, m->name.c_str(), messages.back().second.getLogMonoTime(), words.size() * sizeof(capnp::word));
+    }
   }
 
   update_msgs(current_time, messages);
@@ -110,6 +160,8 @@ void SubMaster::update(int timeout) {
 void SubMaster::update_msgs(uint64_t current_time, const std::vector<std::pair<std::string, cereal::Event::Reader>> &messages){
   if (++frame == UINT64_MAX) frame = 1;
 
+  for (auto &kv : messages_) kv.second->drained.clear();
+
   for (auto &kv : messages) {
     auto m_find = services_.find(kv.first);
     if (m_find == services_.end()){
@@ -117,6 +169,7 @@ void SubMaster::update_msgs(uint64_t current_time, const std::vector<std::pair<s
     }
     SubMessage *m = m_find->second;
     m->event = kv.second;
+    if (m->drain) m->drained.push_back(kv.second);
     m->updated = true;
     m->rcv_time = current_time;
     m->rcv_frame = frame;
@@ -180,6 +233,10 @@ cereal::Event::Reader &SubMaster::operator[](const char *name) const {
   return services_.at(name)->event;
 }
 
+const std::vector<cereal::Event::Reader> &SubMaster::messages(const char *name) const {
+  return services_.at(name)->drained;
+}
+
 SubMaster::~SubMaster() {
   delete poller_;
   for (auto &kv : messages_) {
@@ -200,9 +257,35 @@ PubMaster::PubMaster(const std::vector<const char *> &service_list) {
   }
 }
 
+// only used for tracing, when the caller serialized the message itself
+static uint64_t log_mono_time(const capnp::byte *data, size_t size) {
+  AlignedBuffer buf;
+  capnp::FlatArrayMessageReader reader(buf.align((const char *)data, size));
+  return reader.getRoot<cereal::Event>().getLogMonoTime();
+}
+
+int PubMaster::send(const char *name, capnp::byte *data, size_t size) {
+  if (PUBSUB_TRACE_ENABLED) {
+    pubsub_trace(PUBSUB_TRACE_SEND, name, log_mono_time(data, size), size);
+  }
+  return sockets_.at(name)->send((char *)data, size);
+}
+
 int PubMaster::send(const char *name, MessageBuilder &msg) {
   auto bytes = msg.toBytes();
-  return send(name, bytes.begin(), bytes.size());
+  if (PUBSUB_TRACE_ENABLED) {
+    pubsub_trace(PUBSUB_TRACE_SEND, name, msg.getRoot<cereal::Event>().getLogMonoTime(), bytes.size());
+  }
+  return sockets_.at(name)->send((char *)bytes.begin(), bytes.size());
+}
+
+int PubMaster::sendBatch(const char *name, const std::vector<kj::ArrayPtr<capnp::byte>> &msgs) {
+  if (PUBSUB_TRACE_ENABLED) {
+    for (auto &msg : msgs) {
+      pubsub_trace(PUBSUB_TRACE_SEND, name, log_mono_time(msg.begin(), msg.size()), msg.size());
+    }
+  }
+  return sockets_.at(name)->sendBatch(msgs);
 }
 
 PubMaster::~PubMaster() {
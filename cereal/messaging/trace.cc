@@ -0,0 +1,119 @@
+#include "cereal/messaging/trace.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __APPLE__
+#define CLOCK_BOOTTIME CLOCK_MONOTONIC
+#endif
+
+extern const bool PUBSUB_TRACE_ENABLED = []() {
+  const char *value = std::getenv("PUBSUB_TRACE");
+  return value != nullptr && strcmp(value, "1") == 0;
+}();
+
+static std::mutex ring_lock;
+static std::atomic<pubsub_trace_header_t *> ring{nullptr};
+static bool ring_failed = false;
+static thread_local uint32_t trace_tid = 0;
+
+static uint32_t gettid_cached() {
+  if (trace_tid == 0) {
+#ifdef __linux__
+    trace_tid = syscall(SYS_gettid);
+#else
+    trace_tid = getpid();
+#endif
+  }
+  return trace_tid;
+}
+
+// a forked child writes its own ring
+static void reset_after_fork() {
+  ring = nullptr;
+  ring_failed = false;
+  trace_tid = 0;
+}
+
+static pubsub_trace_header_t *create_ring() {
+  std::string path = "/dev/shm/";
+  if (const char *prefix = std::getenv("OPENPILOT_PREFIX")) {
+    path += std::string(prefix) + "/";
+  }
+  path += "pubsub_trace_" + std::to_string(getpid());
+
+  size_t size = sizeof(pubsub_trace_header_t) + PUBSUB_TRACE_CAPACITY * sizeof(pubsub_trace_event_t);
+  int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0664);
+  if (fd < 0) {
+    std::cout << "Warning, could not open: " << path << std::endl;
+    return nullptr;
+  }
+  int rc = ftruncate(fd, size);
+  char *mem = (rc < 0) ? (char *)MAP_FAILED : (char *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mem == MAP_FAILED) {
+    std::cout << "Warning, could not map: " << path << std::endl;
+    return nullptr;
+  }
+
+  auto header = (pubsub_trace_header_t *)mem;
+  header->capacity = PUBSUB_TRACE_CAPACITY;
+  header->pid = getpid();
+  int comm_fd = open("/proc/self/comm", O_RDONLY | O_CLOEXEC);
+  if (comm_fd >= 0) {
+    ssize_t n = read(comm_fd, header->comm, sizeof(header->comm) - 1);
+    if (n > 0 && header->comm[n - 1] == '\n') header->comm[n - 1] = '\0';
+    close(comm_fd);
+  }
+  // the merge tool ignores the ring until the magic is set
+  std::atomic_thread_fence(std::memory_order_release);
+  header->magic = PUBSUB_TRACE_MAGIC;
+  return header;
+}
+
+void pubsub_trace(PubSubTraceType type, const char *name, uint64_t id, size_t size, uint32_t drain_index) {
+  pubsub_trace_header_t *header = ring.load(std::memory_order_acquire);
+  if (header == nullptr) {
+    std::lock_guard lk(ring_lock);
+    if (ring_failed) return;
+    header = ring.load();
+    if (header == nullptr) {
+      static std::once_flag atfork_flag;
+      std::call_once(atfork_flag, []() { pthread_atfork(nullptr, nullptr, reset_after_fork); });
+
+      header = create_ring();
+      ring_failed = header == nullptr;
+      if (ring_failed) return;
+      ring = header;
+    }
+  }
+
+  struct timespec t;
+  clock_gettime(CLOCK_BOOTTIME, &t);
+
+  uint64_t idx = header->write_index.fetch_add(1, std::memory_order_relaxed);
+  auto events = (pubsub_trace_event_t *)(header + 1);
+  pubsub_trace_event_t &e = events[idx % PUBSUB_TRACE_CAPACITY];
+
+  e.seq.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  e.t = t.tv_sec * 1000000000ULL + t.tv_nsec;
+  e.id = id;
+  e.type = type;
+  e.tid = gettid_cached();
+  e.size = size;
+  e.drain_index = drain_index;
+  strncpy(e.name, name, sizeof(e.name) - 1);
+  e.name[sizeof(e.name) - 1] = '\0';
+  e.seq.store(idx + 1, std::memory_order_release);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Optional tracing of publish/subscribe events, enabled with PUBSUB_TRACE=1.
+// Every process records into its own lock-free ring in /dev/shm/[prefix/]pubsub_trace_<pid>,
+// selfdrive/debug/pubsub_trace.py merges the rings of all processes into a Chrome/Perfetto trace.
+// A send is matched to its receives by service name and id.
+
+#define PUBSUB_TRACE_MAGIC 0x31454341525442ULL // "BTRACE1"
+#define PUBSUB_TRACE_CAPACITY (1 << 15)
+#define PUBSUB_TRACE_NAME_SIZE 32
+
+enum PubSubTraceType : uint32_t {
+  PUBSUB_TRACE_SEND,
+  PUBSUB_TRACE_RECV,
+  PUBSUB_TRACE_VIPC_SEND,
+  PUBSUB_TRACE_VIPC_RECV,
+};
+
+struct pubsub_trace_event_t {
+  std::atomic<uint64_t> seq; // index + 1 once the event is fully written
+  uint64_t t;                // nanos_since_boot when recorded
+  uint64_t id;               // logMonoTime, or frame_id for VisionIpc
+  uint32_t type;
+  uint32_t tid;
+  uint32_t size;             // bytes sent or received
+  uint32_t drain_index;      // position of the message in one update's drain of the socket, >1 means a backlog was drained
+  char name[PUBSUB_TRACE_NAME_SIZE];
+};
+
+struct pubsub_trace_header_t {
+  uint64_t magic;
+  uint32_t capacity;
+  int32_t pid;
+  char comm[16];
+  std::atomic<uint64_t> write_index;
+};
+
+extern const bool PUBSUB_TRACE_ENABLED;
+
+// Callers check PUBSUB_TRACE_ENABLED first, so tracing costs a single branch when disabled
+void pubsub_trace(PubSubTraceType type, const char *name, uint64_t id, size_t size, uint32_t drain_index = 1);
@@ -4,18 +4,40 @@ from typing import Optional
 RESERVED_PORT = 8022  # sshd
 STARTING_PORT = 8001
 
+# msgq ring buffer sizes, DEFAULT_SEGMENT_SIZE must match cereal/messaging/msgq.h
+DEFAULT_SEGMENT_SIZE = 10 * 1024 * 1024
+MIN_SEGMENT_SIZE = 1024 * 1024  # fits messages up to ~340 kB, msgq needs 3x the message size
+SEGMENT_SECONDS = 10.  # how far behind a subscriber can fall before it loses messages
+
+# msgq reader slots, DEFAULT_READER_SLOTS must match NUM_READERS in cereal/messaging/msgq.h and
+# a service can have up to MAX_READERS (64). A subscriber fails to connect when all slots are taken
+DEFAULT_READER_SLOTS = 12
+
 
 def new_port(port: int):
   port += STARTING_PORT
   return port + 1 if port >= RESERVED_PORT else port
 
 
+def segment_size(frequency: float, msg_size: Optional[int]) -> int:
+  # services without a size estimate may send large messages, keep the default for those
+  if msg_size is None:
+    return DEFAULT_SEGMENT_SIZE
+  size = MIN_SEGMENT_SIZE
+  while size < frequency * msg_size * SEGMENT_SECONDS and size < DEFAULT_SEGMENT_SIZE:
+    size *= 2
+  return size
+
+
 class Service:
-  def __init__(self, port: int, should_log: bool, frequency: float, decimation: Optional[int] = None):
+  def __init__(self, port: int, should_log: bool, frequency: float, decimation: Optional[int] = None,
+               segment_size: int = DEFAULT_SEGMENT_SIZE, reader_slots: int = DEFAULT_READER_SLOTS):
     self.port = port
     self.should_log = should_log
     self.frequency = frequency
     self.decimation = decimation
+    self.segment_size = segment_size
+    self.reader_slots = reader_slots
 
 
 services: dict[str, tuple] = {
@@ -104,7 +126,68 @@ services: dict[str, tuple] = {
   "customReservedRawData1": (True, 0.),
   "customReservedRawData2": (True, 0.),
 }
-SERVICE_LIST = {name: Service(new_port(idx), *vals) for
+
+# typical serialized message size in bytes, with some headroom
+msg_sizes: dict[str, int] = {
+  "gyroscope": 200,
+  "gyroscope2": 200,
+  "accelerometer": 200,
+  "accelerometer2": 200,
+  "magnetometer": 200,
+  "lightSensor": 200,
+  "temperatureSensor": 200,
+  "temperatureSensor2": 200,
+  "deviceState": 2000,
+  "can": 8000,
+  "controlsState": 4000,
+  "pandaStates": 2000,
+  "peripheralState": 500,
+  "radarState": 2000,
+  "roadEncodeIdx": 200,
+  "liveTracks": 4000,
+  "sendcan": 2000,
+  "liveCalibration": 500,
+  "liveTorqueParameters": 1000,
+  "carState": 2000,
+  "carControl": 1000,
+  "longitudinalPlan": 3000,
+  "gpsLocationExternal": 300,
+  "gpsLocation": 300,
+  "clocks": 200,
+  "liveLocationKalman": 3000,
+  "liveParameters": 500,
+  "cameraOdometry": 500,
+  "onroadEvents": 1000,
+  "carParams": 20000,
+  "roadCameraState": 500,
+  "driverCameraState": 500,
+  "driverEncodeIdx": 200,
+  "driverStateV2": 1000,
+  "driverMonitoringState": 500,
+  "wideRoadEncodeIdx": 200,
+  "wideRoadCameraState": 500,
+  "managerState": 8000,
+  "navInstruction": 2000,
+  "qRoadEncodeIdx": 200,
+  "microphone": 200,
+  "frogpilotCarControl": 500,
+  "frogpilotDeviceState": 500,
+  "frogpilotNavigation": 500,
+  "frogpilotPlan": 3000,
+  "livestreamWideRoadEncodeIdx": 200,
+  "livestreamRoadEncodeIdx": 200,
+  "livestreamDriverEncodeIdx": 200,
+}
+# services with more subscribers than the default reader slots, with room for debugging tools
+reader_slots: dict[str, int] = {
+  "carState": 24,
+  "deviceState": 24,
+  "controlsState": 24,
+  "modelV2": 16,
+  "liveLocationKalman": 16,
+}
+SERVICE_LIST = {name: Service(new_port(idx), *vals, segment_size=segment_size(vals[1], msg_sizes.get(name)),
+                              reader_slots=reader_slots.get(name, DEFAULT_READER_SLOTS)) for
                 idx, (name, vals) in enumerate(services.items())}
 
 
@@ -117,13 +200,13 @@ def build_header():
   h += "#include <map>\n"
   h += "#include <string>\n"
 
-  h += "struct service { std::string name; int port; bool should_log; int frequency; int decimation; };\n"
+  h += "struct service { std::string name; int port; bool should_log; int frequency; int decimation; size_t segment_size; int reader_slots; };\n"
   h += "static std::map<std::string, service> services = {\n"
   for k, v in SERVICE_LIST.items():
     should_log = "true" if v.should_log else "false"
     decimation = -1 if v.decimation is None else v.decimation
-    h += '  { "%s", {"%s", %d, %s, %d, %d}},\n' % \
-         (k, k, v.port, should_log, v.frequency, decimation)
+    h += '  { "%s", {"%s", %d, %s, %d, %d, %d, %d}},\n' % \
+         (k, k, v.port, should_log, v.frequency, decimation, v.segment_size, v.reader_slots)
   h += "};\n"
 
   h += "#endif\n"
@@ -26,10 +26,39 @@ void VisionBuf::init_yuv(size_t init_width, size_t init_height, size_t init_stri
 }
 
 
+void VisionBuf::init_meta(size_t offset) {
+  this->frame_id = (std::atomic<uint64_t> *)((uint8_t *)this->addr + ALIGN(offset, 8));
+  this->leases = this->frame_id + 1;
+}
+
 uint64_t VisionBuf::get_frame_id() {
-  return *frame_id;
+  return frame_id->load();
 }
 
 void VisionBuf::set_frame_id(uint64_t id) {
-  *frame_id = id;
+  frame_id->store(id);
+}
+
+// try_recycle and lease each write one word and then read the other, so with seq_cst
+// either the client sees the invalid frame id or the server sees the lease
+bool VisionBuf::try_recycle() {
+  uint64_t id = frame_id->exchange(VISIONBUF_INVALID_FRAME_ID);
+  if (leases->load() == 0) {
+    return true;
+  }
+  frame_id->store(id);
+  return false;
+}
+
+bool VisionBuf::lease(int slot, uint64_t id) {
+  leases->fetch_or(1ULL << slot);
+  if (frame_id->load() == id) {
+    return true;
+  }
+  release(slot);
+  return false;
+}
+
+void VisionBuf::release(int slot) {
+  leases->fetch_and(~(1ULL << slot));
 }
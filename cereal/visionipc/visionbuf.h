@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+
 #include "cereal/visionipc/visionipc.h"
 
 #define CL_USE_DEPRECATED_OPENCL_1_2_APIS
@@ -12,6 +14,10 @@
 #define VISIONBUF_SYNC_FROM_DEVICE 0
 #define VISIONBUF_SYNC_TO_DEVICE 1
 
+// shared metadata after the frame data: frame id and lease bitmask, with room to 8 byte align them
+#define VISIONBUF_META_SIZE (3 * sizeof(uint64_t))
+#define VISIONBUF_INVALID_FRAME_ID UINT64_MAX
+
 enum VisionStreamType {
   VISION_STREAM_ROAD,
   VISION_STREAM_DRIVER,
@@ -26,7 +32,8 @@ class VisionBuf {
   size_t len = 0;
   size_t mmap_len = 0;
   void * addr = nullptr;
-  uint64_t *frame_id;
+  std::atomic<uint64_t> *frame_id;
+  std::atomic<uint64_t> *leases; // bit per client slot holding the buffer
   int fd = 0;
 
   bool rgb = false;
@@ -61,6 +68,16 @@ class VisionBuf {
 
   void set_frame_id(uint64_t id);
   uint64_t get_frame_id();
+
+  // Server side, before writing a new frame. Invalidates the frame id so no new lease can be taken,
+  // fails if a client still holds one
+  bool try_recycle();
+  // Client side, fails if the buffer was recycled since the server sent frame id
+  bool lease(int slot, uint64_t id);
+  void release(int slot);
+
+ private:
+  void init_meta(size_t offset);
 };
 
 void visionbuf_compute_aligned_width_and_height(int width, int height, int *aligned_w, int *aligned_h);
@@ -4,6 +4,7 @@
 #include <cstddef>
 
 constexpr int VISIONIPC_MAX_FDS = 128;
+constexpr int VISIONIPC_MAX_CLIENTS = 64; // per stream, one lease bit each
 
 struct VisionIpcBufExtra {
   uint32_t frame_id;
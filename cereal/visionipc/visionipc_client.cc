@@ -3,7 +3,12 @@
 #include <iostream>
 #include <thread>
 
+#include <poll.h>
 #include <unistd.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+#include "cereal/messaging/trace.h"
 #include "cereal/visionipc/ipc.h"
 #include "cereal/visionipc/visionipc_client.h"
 #include "cereal/visionipc/visionipc_server.h"
@@ -20,7 +25,7 @@ static int connect_to_vipc_server(const std::string &name, bool blocking) {
   return socket_fd;
 }
 
-VisionIpcClient::VisionIpcClient(std::string name, VisionStreamType type, bool conflate, cl_device_id device_id, cl_context ctx) : name(name), type(type), device_id(device_id), ctx(ctx) {
+VisionIpcClient::VisionIpcClient(std::string name, VisionStreamType type, bool conflate, cl_device_id device_id, cl_context ctx, bool leases) : name(name), device_id(device_id), ctx(ctx), use_leases(leases), type(type) {
   msg_ctx = Context::create();
   sock = SubSocket::create(msg_ctx, get_endpoint_name(name, type), "127.0.0.1", conflate, false);
 
@@ -31,6 +36,7 @@ VisionIpcClient::VisionIpcClient(std::string name, VisionStreamType type, bool c
 // Connect is not thread safe. Do not use the buffers while calling connect
 bool VisionIpcClient::connect(bool blocking){
   connected = false;
+  disconnect();
 
   // Cleanup old buffers on reconnect
   for (size_t i = 0; i < num_buffers; i++){
@@ -45,8 +51,11 @@ bool VisionIpcClient::connect(bool blocking){
   if (socket_fd < 0) {
     return false;
   }
-  // Send stream type to server to request FDs
-  int r = ipc_sendrecv_with_fds(true, socket_fd, &type, sizeof(type), nullptr, 0, nullptr);
+  // Send stream type to server to request FDs, with an eventfd to be notified of new frames
+#ifdef __linux__
+  event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
+  int r = ipc_sendrecv_with_fds(true, socket_fd, &type, sizeof(type), &event_fd, event_fd >= 0 ? 1 : 0, nullptr);
   assert(r == sizeof(type));
 
   // Get FDs
@@ -71,19 +80,69 @@ bool VisionIpcClient::connect(bool blocking){
     if (device_id) buffers[i].init_cl(device_id, ctx);
   }
 
-  close(socket_fd);
+  if (event_fd >= 0) {
+    r = ipc_sendrecv_with_fds(false, socket_fd, &slot, sizeof(slot), nullptr, 0, nullptr);
+    if (r != sizeof(slot) || slot < 0) {
+      LOGW("VisionIpcClient %s: not registered with the server, no frame notifications or leases", name.c_str());
+      slot = -1;
+      close(event_fd);
+      event_fd = -1;
+    }
+  }
+
+  // the server keeps track of registered clients through the open connection
+  if (slot >= 0) {
+    conn_fd = socket_fd;
+  } else {
+    close(socket_fd);
+  }
   connected = true;
   return true;
 }
 
-VisionBuf * VisionIpcClient::recv(VisionIpcBufExtra * extra, const int timeout_ms){
-  auto p = poller->poll(timeout_ms);
+void VisionIpcClient::disconnect(){
+  release();
+  if (event_fd >= 0) close(event_fd);
+  if (conn_fd >= 0) close(conn_fd);
+  event_fd = conn_fd = slot = -1;
+}
 
-  if (!p.size()){
-    return nullptr;
+void VisionIpcClient::release(){
+  if (leased_idx >= 0) {
+    buffers[leased_idx].release(slot);
+    leased_idx = -1;
+  }
+}
+
+Message * VisionIpcClient::receive(int timeout_ms){
+  if (event_fd < 0) {
+    auto p = poller->poll(timeout_ms);
+    if (!p.size()) {
+      return nullptr;
+    }
+    return sock->receive(true);
   }
 
+  // the eventfd is only cleared once the queue was seen empty, so it stays readable while frames are pending
   Message * r = sock->receive(true);
+  if (r == nullptr) {
+#ifdef __linux__
+    eventfd_t count;
+    eventfd_read(event_fd, &count);
+#endif
+    r = sock->receive(true);
+  }
+  if (r == nullptr) {
+    struct pollfd pfd = {.fd = event_fd, .events = POLLIN};
+    if (poll(&pfd, 1, timeout_ms) > 0) {
+      r = sock->receive(true);
+    }
+  }
+  return r;
+}
+
+VisionBuf * VisionIpcClient::recv(VisionIpcBufExtra * extra, const int timeout_ms){
+  Message * r = receive(timeout_ms);
   if (r == nullptr){
     return nullptr;
   }
@@ -101,10 +160,24 @@ VisionBuf * VisionIpcClient::recv(VisionIpcBufExtra * extra, const int timeout_m
     return nullptr;
   }
 
+  if (use_leases && slot >= 0) {
+    release();
+    if (!buf->lease(slot, packet->extra.frame_id)) {
+      dropped_frames++;
+      delete r;
+      return nullptr;
+    }
+    leased_idx = packet->idx;
+  }
+
   if (extra) {
     *extra = packet->extra;
   }
 
+  if (PUBSUB_TRACE_ENABLED) {
+    pubsub_trace(PUBSUB_TRACE_VIPC_RECV, get_endpoint_name(name, type).c_str(), packet->extra.frame_id, buf->len);
+  }
+
   if (buf->sync(VISIONBUF_SYNC_TO_DEVICE) != 0) {
     LOGE("Failed to sync buffer");
   }
@@ -131,6 +204,7 @@ std::set<VisionStreamType> VisionIpcClient::getAvailableStreams(const std::strin
 }
 
 VisionIpcClient::~VisionIpcClient(){
+  disconnect();
   for (size_t i = 0; i < num_buffers; i++){
     if (buffers[i].free() != 0) {
       LOGE("Failed to free buffer %zu", i);
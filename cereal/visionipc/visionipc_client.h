@@ -16,15 +16,32 @@ private:
   cl_device_id device_id = nullptr;
   cl_context ctx = nullptr;
 
+  // registered with the server: notified through event_fd, and slot is this client's lease bit
+  int conn_fd = -1;
+  int event_fd = -1;
+  int slot = -1;
+  bool use_leases = false;
+  int leased_idx = -1;
+
+  Message * receive(int timeout_ms);
+  void disconnect();
+
 public:
   bool connected = false;
   VisionStreamType type;
   int num_buffers = 0;
   VisionBuf buffers[VISIONIPC_MAX_FDS];
-  VisionIpcClient(std::string name, VisionStreamType type, bool conflate, cl_device_id device_id=nullptr, cl_context ctx=nullptr);
+  uint64_t dropped_frames = 0; // frames recycled by the server before they could be leased
+  // With leases, the buffer returned by recv can't be recycled by the server until the next recv or release(),
+  // so it covers reads done before then, not a buffer handed on to hardware that reads it later.
+  // recv returns nullptr and counts a dropped frame instead of returning a recycled buffer
+  VisionIpcClient(std::string name, VisionStreamType type, bool conflate, cl_device_id device_id=nullptr, cl_context ctx=nullptr, bool leases=false);
   ~VisionIpcClient();
   VisionBuf * recv(VisionIpcBufExtra * extra=nullptr, const int timeout_ms=100);
+  void release();
   bool connect(bool blocking=true);
   bool is_connected() { return connected; }
+  // readable when a new frame may be available, for integration into poll/epoll loops. -1 if unsupported
+  int fd() { return event_fd; }
   static std::set<VisionStreamType> getAvailableStreams(const std::string &name, bool blocking = true);
 };
@@ -1,14 +1,20 @@
 #include <iostream>
+#include <algorithm>
 #include <chrono>
 #include <cassert>
+#include <cinttypes>
 #include <random>
 #include <limits>
 
 #include <poll.h>
 #include <sys/socket.h>
 #include <unistd.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
 
 #include "cereal/messaging/messaging.h"
+#include "cereal/messaging/trace.h"
 #include "cereal/visionipc/ipc.h"
 #include "cereal/visionipc/visionipc_server.h"
 #include "cereal/logger/logger.h"
@@ -76,6 +82,8 @@ void VisionIpcServer::create_buffers_with_sizes(VisionStreamType type, size_t nu
   }
 
   cur_idx[type] = 0;
+  leased_skips[type] = 0;
+  leased_overwrites[type] = 0;
 
   // Create msgq publisher for each of the `name` + type combos
   // TODO: compute port number directly if using zmq
@@ -96,12 +104,16 @@ void VisionIpcServer::listener(){
   assert(sock >= 0);
 
   while (!should_exit){
-    // Wait for incoming connection
-    struct pollfd polls[1] = {{0}};
-    polls[0].fd = sock;
-    polls[0].events = POLLIN;
+    // Wait for incoming connection, or registered clients hanging up
+    std::vector<struct pollfd> polls = {{.fd = sock, .events = POLLIN}};
+    {
+      std::lock_guard lk(clients_lock);
+      for (auto &c : clients) {
+        polls.push_back({.fd = c.conn_fd, .events = POLLIN});
+      }
+    }
 
-    int ret = poll(polls, 1, 100);
+    int ret = poll(polls.data(), polls.size(), 100);
     if (ret < 0) {
       if (errno == EINTR || errno == EAGAIN) continue;
       std::cout << "poll failed, stopping listener" << std::endl;
@@ -109,6 +121,14 @@ void VisionIpcServer::listener(){
     }
 
     if (should_exit) break;
+
+    // registered clients don't send anything after connecting, so any event is a hangup
+    for (size_t i = 1; i < polls.size(); i++) {
+      if (polls[i].revents) {
+        unregister_client(polls[i].fd);
+      }
+    }
+
     if (!polls[0].revents) {
       continue;
     }
@@ -117,9 +137,14 @@ void VisionIpcServer::listener(){
     int fd = accept(sock, NULL, NULL);
     assert(fd >= 0);
 
+    // clients that want frame notifications send an eventfd with the request
     VisionStreamType type = VisionStreamType::VISION_STREAM_MAX;
-    int r = ipc_sendrecv_with_fds(false, fd, &type, sizeof(type), nullptr, 0, nullptr);
+    int event_fd = -1, num_event_fds = 0;
+    int r = ipc_sendrecv_with_fds(false, fd, &type, sizeof(type), &event_fd, 1, &num_event_fds);
     assert(r == sizeof(type));
+    if (num_event_fds == 0) {
+      event_fd = -1;
+    }
 
     // send available stream types
     if (type == VisionStreamType::VISION_STREAM_MAX) {
@@ -129,12 +154,14 @@ void VisionIpcServer::listener(){
       }
       r = ipc_sendrecv_with_fds(true, fd, available_stream_types.data(), available_stream_types.size() * sizeof(VisionStreamType), nullptr, 0, nullptr);
       assert(r == available_stream_types.size() * sizeof(VisionStreamType));
+      if (event_fd >= 0) close(event_fd);
       close(fd);
       continue;
     }
 
     if (buffers.count(type) <= 0) {
       std::cout << "got request for invalid buffer type: " << type << std::endl;
+      if (event_fd >= 0) close(event_fd);
       close(fd);
       continue;
     }
@@ -157,6 +184,13 @@ void VisionIpcServer::listener(){
 
     r = ipc_sendrecv_with_fds(true, fd, &bufs, sizeof(VisionBuf) * num_fds, fds, num_fds, nullptr);
 
+    if (event_fd >= 0) {
+      // the slot is the client's lease bit, -1 if the stream has no free slots
+      int slot = register_client(type, fd, event_fd);
+      ipc_sendrecv_with_fds(true, fd, &slot, sizeof(slot), nullptr, 0, nullptr);
+      if (slot >= 0) continue;
+      close(event_fd);
+    }
     close(fd);
   }
 
@@ -165,13 +199,56 @@ void VisionIpcServer::listener(){
   unlink(ipc_path.c_str());
 }
 
+int VisionIpcServer::register_client(VisionStreamType type, int conn_fd, int event_fd){
+  std::lock_guard lk(clients_lock);
+  uint64_t used = 0;
+  for (auto &c : clients) {
+    if (c.type == type) used |= 1ULL << c.slot;
+  }
+  for (int slot = 0; slot < VISIONIPC_MAX_CLIENTS; slot++) {
+    if (!(used & (1ULL << slot))) {
+      clients.push_back({type, slot, conn_fd, event_fd});
+      return slot;
+    }
+  }
+  LOGW("visionipc %s: no free client slots for stream %d", name.c_str(), type);
+  return -1;
+}
+
+void VisionIpcServer::unregister_client(int conn_fd){
+  std::lock_guard lk(clients_lock);
+  auto it = std::find_if(clients.begin(), clients.end(), [=](auto &c) { return c.conn_fd == conn_fd; });
+  if (it == clients.end()) return;
+
+  // a client that exited or reconnected doesn't hold anything anymore
+  for (VisionBuf *buf : buffers[it->type]) {
+    buf->release(it->slot);
+  }
+  close(it->event_fd);
+  close(it->conn_fd);
+  clients.erase(it);
+}
 
 
 VisionBuf * VisionIpcServer::get_buffer(VisionStreamType type){
-  // Do we want to keep track if the buffer has been sent out yet and warn user?
   assert(buffers.count(type));
-  auto b = buffers[type];
-  return b[cur_idx[type]++ % b.size()];
+  auto &b = buffers[type];
+
+  // skip buffers leased by clients
+  for (size_t i = 0; i < b.size(); i++) {
+    VisionBuf *buf = b[cur_idx[type]++ % b.size()];
+    if (buf->try_recycle()) {
+      return buf;
+    }
+    leased_skips[type]++;
+  }
+
+  // all of them are leased, overwrite the oldest. The clients see the invalid frame id, but can read a torn frame
+  VisionBuf *buf = b[cur_idx[type]++ % b.size()];
+  buf->set_frame_id(VISIONBUF_INVALID_FRAME_ID);
+  LOGW("visionipc %s: all buffers of stream %d are leased, overwriting %zu (%" PRIu64 " times, %" PRIu64 " skipped)",
+       name.c_str(), type, buf->idx, ++leased_overwrites[type], leased_skips[type].load());
+  return buf;
 }
 
 void VisionIpcServer::send(VisionBuf * buf, VisionIpcBufExtra * extra, bool sync){
@@ -189,13 +266,33 @@ void VisionIpcServer::send(VisionBuf * buf, VisionIpcBufExtra * extra, bool sync
   packet.idx = buf->idx;
   packet.extra = *extra;
 
+  // also publishes the frame for lease holders, get_buffer invalidated it
+  buf->set_frame_id(extra->frame_id);
+
+  if (PUBSUB_TRACE_ENABLED) {
+    pubsub_trace(PUBSUB_TRACE_VIPC_SEND, get_endpoint_name(name, buf->type).c_str(), extra->frame_id, buf->len);
+  }
   sockets[buf->type]->send((char*)&packet, sizeof(packet));
+
+#ifdef __linux__
+  std::lock_guard lk(clients_lock);
+  for (auto &c : clients) {
+    if (c.type == buf->type) {
+      eventfd_write(c.event_fd, 1);
+    }
+  }
+#endif
 }
 
 VisionIpcServer::~VisionIpcServer(){
   should_exit = true;
   listener_thread.join();
 
+  for (auto &c : clients) {
+    close(c.event_fd);
+    close(c.conn_fd);
+  }
+
   // VisionBuf cleanup
   for (auto const& [type, buf] : buffers) {
     for (VisionBuf* b : buf){
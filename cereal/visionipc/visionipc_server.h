@@ -4,6 +4,7 @@
 #include <thread>
 #include <atomic>
 #include <map>
+#include <mutex>
 
 #include "cereal/messaging/messaging.h"
 #include "cereal/visionipc/visionbuf.h"
@@ -23,11 +24,24 @@ class VisionIpcServer {
 
   std::map<VisionStreamType, std::atomic<size_t> > cur_idx;
   std::map<VisionStreamType, std::vector<VisionBuf*> > buffers;
+  std::map<VisionStreamType, std::atomic<uint64_t> > leased_skips, leased_overwrites;
 
   Context * msg_ctx;
   std::map<VisionStreamType, PubSocket*> sockets;
 
+  // Clients that registered an eventfd keep their connection open, the server drops them and their leases on hangup
+  struct ClientConn {
+    VisionStreamType type;
+    int slot;
+    int conn_fd;
+    int event_fd;
+  };
+  std::mutex clients_lock;
+  std::vector<ClientConn> clients;
+
   void listener(void);
+  int register_client(VisionStreamType type, int conn_fd, int event_fd);
+  void unregister_client(int conn_fd);
 
  public:
   VisionIpcServer(std::string name, cl_device_id device_id=nullptr, cl_context ctx=nullptr);
@@ -1,6 +1,8 @@
 #include <thread>
 #include <chrono>
 
+#include <poll.h>
+
 #include "catch2/catch.hpp"
 #include "cereal/visionipc/visionipc_server.h"
 #include "cereal/visionipc/visionipc_client.h"
@@ -146,3 +148,70 @@ TEST_CASE("Test conflate"){
   recv_buf = client.recv(&extra_recv);
   REQUIRE(recv_buf == nullptr);
 }
+
+TEST_CASE("Frame notification fd"){
+  VisionIpcServer server("camerad");
+  server.create_buffers(VISION_STREAM_ROAD, 1, true, 100, 100);
+  server.start_listener();
+
+  VisionIpcClient client = VisionIpcClient("camerad", VISION_STREAM_ROAD, false);
+  REQUIRE(client.connect());
+  REQUIRE(client.fd() >= 0);
+
+  struct pollfd pfd = {.fd = client.fd(), .events = POLLIN};
+  REQUIRE(poll(&pfd, 1, 0) == 0);
+
+  VisionBuf * buf = server.get_buffer(VISION_STREAM_ROAD);
+  VisionIpcBufExtra extra = {0};
+  extra.frame_id = 1;
+  server.send(buf, &extra);
+
+  REQUIRE(poll(&pfd, 1, 1000) == 1);
+  REQUIRE(client.recv() != nullptr);
+  REQUIRE(client.recv(nullptr, 0) == nullptr);
+  REQUIRE(poll(&pfd, 1, 0) == 0);
+}
+
+TEST_CASE("Leased buffers are not recycled"){
+  VisionIpcServer server("camerad");
+  server.create_buffers(VISION_STREAM_ROAD, 2, true, 100, 100);
+  server.start_listener();
+
+  VisionIpcClient client = VisionIpcClient("camerad", VISION_STREAM_ROAD, false, nullptr, nullptr, true);
+  REQUIRE(client.connect());
+
+  VisionBuf * buf = server.get_buffer(VISION_STREAM_ROAD);
+  VisionIpcBufExtra extra = {0};
+  extra.frame_id = 1;
+  server.send(buf, &extra);
+
+  VisionBuf * recv_buf = client.recv();
+  REQUIRE(recv_buf != nullptr);
+  REQUIRE(recv_buf->idx == buf->idx);
+
+  // the server skips the leased buffer until the client releases it
+  for (int i = 0; i < 4; i++) {
+    REQUIRE(server.get_buffer(VISION_STREAM_ROAD)->idx != buf->idx);
+  }
+  client.release();
+  REQUIRE(server.get_buffer(VISION_STREAM_ROAD)->idx == buf->idx);
+}
+
+TEST_CASE("Recycled frames are dropped"){
+  VisionIpcServer server("camerad");
+  server.create_buffers(VISION_STREAM_ROAD, 1, true, 100, 100);
+  server.start_listener();
+
+  VisionIpcClient client = VisionIpcClient("camerad", VISION_STREAM_ROAD, false, nullptr, nullptr, true);
+  REQUIRE(client.connect());
+
+  VisionBuf * buf = server.get_buffer(VISION_STREAM_ROAD);
+  VisionIpcBufExtra extra = {0};
+  extra.frame_id = 1;
+  server.send(buf, &extra);
+
+  // recycled before the client got to it
+  REQUIRE(server.get_buffer(VISION_STREAM_ROAD) == buf);
+  REQUIRE(client.recv() == nullptr);
+  REQUIRE(client.dropped_frames == 1);
+}
@@ -1,13 +1,13 @@
 #include "opendbc/can/common.h"
 
 
-unsigned int honda_checksum(uint32_t address, const Signal &sig, const std::vector<uint8_t> &d) {
+unsigned int honda_checksum(uint32_t address, const Signal &sig, const uint8_t *d, size_t size) {
   int s = 0;
   bool extended = address > 0x7FF;
   while (address) { s += (address & 0xF); address >>= 4; }
-  for (int i = 0; i < d.size(); i++) {
+  for (size_t i = 0; i < size; i++) {
     uint8_t x = d[i];
-    if (i == d.size()-1) x >>= 4; // remove checksum
+    if (i == size-1) x >>= 4; // remove checksum
     s += (x & 0xF) + (x >> 4);
   }
   s = 8-s;
@@ -16,58 +16,29 @@ unsigned int honda_checksum(uint32_t address, const Signal &sig, const std::vect
   return s & 0xF;
 }
 
-unsigned int toyota_checksum(uint32_t address, const Signal &sig, const std::vector<uint8_t> &d) {
-  unsigned int s = d.size();
+unsigned int toyota_checksum(uint32_t address, const Signal &sig, const uint8_t *d, size_t size) {
+  unsigned int s = size;
   while (address) { s += address & 0xFF; address >>= 8; }
-  for (int i = 0; i < d.size() - 1; i++) { s += d[i]; }
+  for (size_t i = 0; i + 1 < size; i++) { s += d[i]; }
 
   return s & 0xFF;
 }
 
-unsigned int subaru_checksum(uint32_t address, const Signal &sig, const std::vector<uint8_t> &d) {
+unsigned int subaru_checksum(uint32_t address, const Signal &sig, const uint8_t *d, size_t size) {
   unsigned int s = 0;
   while (address) { s += address & 0xFF; address >>= 8; }
 
   // skip checksum in first byte
-  for (int i = 1; i < d.size(); i++) { s += d[i]; }
+  for (size_t i = 1; i < size; i++) { s += d[i]; }
 
   return s & 0xFF;
 }
 
-unsigned int chrysler_checksum(uint32_t address, const Signal &sig, const std::vector<uint8_t> &d) {
-  // jeep chrysler canbus checksum from http://illmatics.com/Remote%20Car%20Hacking.pdf
-  uint8_t checksum = 0xFF;
-  for (int j = 0; j < (d.size() - 1); j++) {
-    uint8_t shift = 0x80;
-    uint8_t curr = d[j];
-    for (int i = 0; i < 8; i++) {
-      uint8_t bit_sum = curr & shift;
-      uint8_t temp_chk = checksum & 0x80U;
-      if (bit_sum != 0U) {
-        bit_sum = 0x1C;
-        if (temp_chk != 0U) {
-          bit_sum = 1;
-        }
-        checksum = checksum << 1;
-        temp_chk = checksum | 1U;
-        bit_sum ^= temp_chk;
-      } else {
-        if (temp_chk != 0U) {
-          bit_sum = 0x1D;
-        }
-        checksum = checksum << 1;
-        bit_sum ^= checksum;
-      }
-      checksum = bit_sum;
-      shift = shift >> 1;
-    }
-  }
-  return ~checksum & 0xFF;
-}
-
-// Static lookup table for fast computation of CRCs
+// Static lookup tables for fast computation of CRCs
 uint8_t crc8_lut_8h2f[256]; // CRC8 poly 0x2F, aka 8H2F/AUTOSAR
-uint16_t crc16_lut_xmodem[256]; // CRC16 poly 0x1021, aka XMODEM
+uint8_t crc8_lut_j1850[256]; // CRC8 poly 0x1D, aka SAE J1850
+uint8_t crc8_lut_d5[256]; // CRC8 poly 0xD5
+uint16_t crc16_lut_xmodem[8][256]; // CRC16 poly 0x1021, aka XMODEM, sliced 8 bytes at a time
 
 void gen_crc_lookup_table_8(uint8_t poly, uint8_t crc_lut[]) {
   uint8_t crc;
@@ -102,13 +73,36 @@ void gen_crc_lookup_table_16(uint16_t poly, uint16_t crc_lut[]) {
   }
 }
 
+void gen_crc_slice_tables_16(uint16_t crc_lut[][256], int slices) {
+  // crc_lut[j][b] is the CRC of byte b followed by j zero bytes
+  for (int j = 1; j < slices; j++) {
+    for (int i = 0; i < 256; i++) {
+      uint16_t crc = crc_lut[j - 1][i];
+      crc_lut[j][i] = (crc << 8) ^ crc_lut[0][crc >> 8];
+    }
+  }
+}
+
 void init_crc_lookup_tables() {
   // At init time, set up static lookup tables for fast CRC computation.
   gen_crc_lookup_table_8(0x2F, crc8_lut_8h2f);    // CRC-8 8H2F/AUTOSAR for Volkswagen
-  gen_crc_lookup_table_16(0x1021, crc16_lut_xmodem);    // CRC-16 XMODEM for HKG CAN FD
+  gen_crc_lookup_table_8(0x1D, crc8_lut_j1850);    // CRC-8 SAE J1850 for Chrysler
+  gen_crc_lookup_table_8(0xD5, crc8_lut_d5);    // CRC-8 for the comma pedal
+  gen_crc_lookup_table_16(0x1021, crc16_lut_xmodem[0]);    // CRC-16 XMODEM for HKG CAN FD
+  gen_crc_slice_tables_16(crc16_lut_xmodem, 8);
+}
+
+unsigned int chrysler_checksum(uint32_t address, const Signal &sig, const uint8_t *d, size_t size) {
+  // jeep chrysler canbus checksum from http://illmatics.com/Remote%20Car%20Hacking.pdf
+  // this is CRC8 SAE J1850 (poly 0x1D, init 0xFF, final XOR 0xFF) over all but the checksum byte
+  uint8_t crc = 0xFF;
+  for (size_t i = 0; i + 1 < size; i++) {
+    crc = crc8_lut_j1850[crc ^ d[i]];
+  }
+  return crc ^ 0xFF;
 }
 
-unsigned int volkswagen_mqb_checksum(uint32_t address, const Signal &sig, const std::vector<uint8_t> &d) {
+unsigned int volkswagen_mqb_checksum(uint32_t address, const Signal &sig, const uint8_t *d, size_t size) {
   // Volkswagen uses standard CRC8 8H2F/AUTOSAR, but they compute it with
   // a magic variable padding byte tacked onto the end of the payload.
   // https://www.autosar.org/fileadmin/user_upload/standards/classic/4-3/AUTOSAR_SWS_CRCLibrary.pdf
@@ -116,7 +110,7 @@ unsigned int volkswagen_mqb_checksum(uint32_t address, const Signal &sig, const
   uint8_t crc = 0xFF; // Standard init value for CRC8 8H2F/AUTOSAR
 
   // CRC the payload first, skipping over the first byte where the CRC lives.
-  for (int i = 1; i < d.size(); i++) {
+  for (size_t i = 1; i < size; i++) {
     crc ^= d[i];
     crc = crc8_lut_8h2f[crc];
   }
@@ -189,12 +183,12 @@ unsigned int volkswagen_mqb_checksum(uint32_t address, const Signal &sig, const
   return crc ^ 0xFF; // Return after standard final XOR for CRC8 8H2F/AUTOSAR
 }
 
-unsigned int xor_checksum(uint32_t address, const Signal &sig, const std::vector<uint8_t> &d) {
+unsigned int xor_checksum(uint32_t address, const Signal &sig, const uint8_t *d, size_t size) {
   uint8_t checksum = 0;
-  int checksum_byte = sig.start_bit / 8;
+  size_t checksum_byte = sig.start_bit / 8;
 
   // Simple XOR over the payload, except for the byte where the checksum lives.
-  for (int i = 0; i < d.size(); i++) {
+  for (size_t i = 0; i < size; i++) {
     if (i != checksum_byte) {
       checksum ^= d[i];
     }
@@ -203,42 +197,42 @@ unsigned int xor_checksum(uint32_t address, const Signal &sig, const std::vector
   return checksum;
 }
 
-unsigned int pedal_checksum(uint32_t address, const Signal &sig, const std::vector<uint8_t> &d) {
-  uint8_t crc = 0xFF;
-  uint8_t poly = 0xD5; // standard crc8
+unsigned int pedal_checksum(uint32_t address, const Signal &sig, const uint8_t *d, size_t size) {
+  uint8_t crc = 0xFF; // standard crc8, poly 0xD5
 
   // skip checksum byte
-  for (int i = d.size()-2; i >= 0; i--) {
-    crc ^= d[i];
-    for (int j = 0; j < 8; j++) {
-      if ((crc & 0x80) != 0) {
-        crc = (uint8_t)((crc << 1) ^ poly);
-      } else {
-        crc <<= 1;
-      }
-    }
+  for (int i = (int)size - 2; i >= 0; i--) {
+    crc = crc8_lut_d5[crc ^ d[i]];
   }
   return crc;
 }
 
-unsigned int hkg_can_fd_checksum(uint32_t address, const Signal &sig, const std::vector<uint8_t> &d) {
+unsigned int hkg_can_fd_checksum(uint32_t address, const Signal &sig, const uint8_t *d, size_t size) {
+  const auto &lut = crc16_lut_xmodem;
   uint16_t crc = 0;
 
-  for (int i = 2; i < d.size(); i++) {
-    crc = (crc << 8) ^ crc16_lut_xmodem[(crc >> 8) ^ d[i]];
+  // skip the checksum in the first two bytes, then process 8 bytes per step
+  size_t i = 2;
+  for (; i + 8 <= size; i += 8) {
+    crc = lut[7][(crc >> 8) ^ d[i]] ^ lut[6][(crc & 0xFF) ^ d[i + 1]] ^
+          lut[5][d[i + 2]] ^ lut[4][d[i + 3]] ^ lut[3][d[i + 4]] ^
+          lut[2][d[i + 5]] ^ lut[1][d[i + 6]] ^ lut[0][d[i + 7]];
+  }
+  for (; i < size; i++) {
+    crc = (crc << 8) ^ lut[0][(crc >> 8) ^ d[i]];
   }
 
   // Add address to crc
-  crc = (crc << 8) ^ crc16_lut_xmodem[(crc >> 8) ^ ((address >> 0) & 0xFF)];
-  crc = (crc << 8) ^ crc16_lut_xmodem[(crc >> 8) ^ ((address >> 8) & 0xFF)];
+  crc = (crc << 8) ^ lut[0][(crc >> 8) ^ ((address >> 0) & 0xFF)];
+  crc = (crc << 8) ^ lut[0][(crc >> 8) ^ ((address >> 8) & 0xFF)];
 
-  if (d.size() == 8) {
+  if (size == 8) {
     crc ^= 0x5f29;
-  } else if (d.size() == 16) {
+  } else if (size == 16) {
     crc ^= 0x041d;
-  } else if (d.size() == 24) {
+  } else if (size == 24) {
     crc ^= 0x819d;
-  } else if (d.size() == 32) {
+  } else if (size == 32) {
     crc ^= 0x9f5b;
   }
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstring>
 #include <map>
 #include <string>
 #include <utility>
@@ -22,40 +23,136 @@
 
 #define MAX_BAD_COUNTER 5
 #define CAN_INVALID_CNT 5
+#define CAN_HISTORY_SIZE 64  // initial values kept per signal between queries, grows when full
+#define CAN_MAX_DATA_SIZE 64
+// payload copies are padded so a 9 byte window starting at any byte can be loaded
+#define CAN_PADDED_DATA_SIZE (CAN_MAX_DATA_SIZE + 8)
 
 void init_crc_lookup_tables();
 
 // Car specific functions
-unsigned int honda_checksum(uint32_t address, const Signal &sig, const std::vector<uint8_t> &d);
-unsigned int toyota_checksum(uint32_t address, const Signal &sig, const std::vector<uint8_t> &d);
-unsigned int subaru_checksum(uint32_t address, const Signal &sig, const std::vector<uint8_t> &d);
-unsigned int chrysler_checksum(uint32_t address, const Signal &sig, const std::vector<uint8_t> &d);
-unsigned int volkswagen_mqb_checksum(uint32_t address, const Signal &sig, const std::vector<uint8_t> &d);
-unsigned int xor_checksum(uint32_t address, const Signal &sig, const std::vector<uint8_t> &d);
-unsigned int hkg_can_fd_checksum(uint32_t address, const Signal &sig, const std::vector<uint8_t> &d);
-unsigned int pedal_checksum(uint32_t address, const Signal &sig, const std::vector<uint8_t> &d);
-
-class MessageState {
+unsigned int honda_checksum(uint32_t address, const Signal &sig, const uint8_t *d, size_t size);
+unsigned int toyota_checksum(uint32_t address, const Signal &sig, const uint8_t *d, size_t size);
+unsigned int subaru_checksum(uint32_t address, const Signal &sig, const uint8_t *d, size_t size);
+unsigned int chrysler_checksum(uint32_t address, const Signal &sig, const uint8_t *d, size_t size);
+unsigned int volkswagen_mqb_checksum(uint32_t address, const Signal &sig, const uint8_t *d, size_t size);
+unsigned int xor_checksum(uint32_t address, const Signal &sig, const uint8_t *d, size_t size);
+unsigned int hkg_can_fd_checksum(uint32_t address, const Signal &sig, const uint8_t *d, size_t size);
+unsigned int pedal_checksum(uint32_t address, const Signal &sig, const uint8_t *d, size_t size);
+
+int64_t get_raw_value(const std::vector<uint8_t> &msg, const Signal &sig);
+
+// Signal decoding precompiled into one unaligned 64-bit load plus shift/mask.
+// extract() expects a zero padded buffer of CAN_PADDED_DATA_SIZE bytes.
+struct SignalExtractor {
+  uint8_t first_byte;  // lowest byte index covered by the signal
+  uint8_t msb_byte;    // signal reads as zero if the frame ends before this byte
+  uint8_t num_bytes;   // bytes covered, up to 9 for a 64-bit unaligned signal
+  uint8_t shift;
+  uint8_t size;
+  bool is_little_endian;
+  bool is_signed;
+  uint64_t mask;
+  double factor, offset;
+
+  SignalExtractor() = default;
+  SignalExtractor(const Signal &sig);
+
+  inline uint64_t extract(const uint8_t *buf, size_t dat_size) const {
+    if (msb_byte >= dat_size) return 0;
+
+    uint64_t w;
+    memcpy(&w, buf + first_byte, sizeof(w));
+    uint64_t ret;
+    if (is_little_endian) {
+      ret = w >> shift;
+      if (num_bytes > 8) ret |= (uint64_t)buf[first_byte + 8] << (64 - shift);
+    } else {
+      w = __builtin_bswap64(w);
+      if (num_bytes > 8) {
+        ret = (w << (8 - shift)) | (buf[first_byte + 8] >> shift);
+      } else {
+        ret = w >> (8 * (8 - num_bytes) + shift);
+      }
+    }
+    return ret & mask;
+  }
+
+  // inverse of extract(), writes the low size bits of ival into the padded buffer
+  inline void insert(uint8_t *buf, uint64_t ival) const {
+    ival &= mask;
+
+    uint64_t w;
+    memcpy(&w, buf + first_byte, sizeof(w));
+    uint8_t &last = buf[first_byte + 8];
+    if (is_little_endian) {
+      w = (w & ~(mask << shift)) | (ival << shift);
+      if (num_bytes > 8) last = (last & ~(mask >> (64 - shift))) | (ival >> (64 - shift));
+    } else {
+      w = __builtin_bswap64(w);
+      if (num_bytes > 8) {
+        w = (w & ~(mask >> (8 - shift))) | (ival >> (8 - shift));
+        last = (last & ((1U << shift) - 1)) | (uint8_t)(ival << shift);
+      } else {
+        const int s = 8 * (8 - num_bytes) + shift;
+        w = (w & ~(mask << s)) | (ival << s);
+      }
+      w = __builtin_bswap64(w);
+    }
+    memcpy(buf + first_byte, &w, sizeof(w));
+  }
+
+  inline double decode(const uint8_t *buf, size_t dat_size) const {
+    int64_t tmp = extract(buf, dat_size);
+    if (is_signed) {
+      tmp -= ((tmp >> (size-1)) & 0x1) ? (1ULL << size) : 0;
+    }
+    return tmp * factor + offset;
+  }
+};
+
+// Open addressing address -> slot table, built once from the parsed messages
+class AddressIndex {
 public:
+  void build(const std::vector<uint32_t> &addresses);
+
+  inline int find(uint32_t address) const {
+    for (uint32_t i = hash(address); ; i = (i + 1) & mask) {
+      const Entry &e = entries[i];
+      if (e.slot < 0) return -1;
+      if (e.address == address) return e.slot;
+    }
+  }
+
+private:
+  struct Entry {
+    uint32_t address;
+    int32_t slot;
+  };
+
+  inline uint32_t hash(uint32_t address) const {
+    return (address * 0x9E3779B1U) >> hash_shift;
+  }
+
+  // an empty table, as build() makes it for no addresses. a shift by 32 would be undefined
+  std::vector<Entry> entries = {{0, -1}, {0, -1}};
+  uint32_t mask = 1;
+  uint32_t hash_shift = 31;
+};
+
+// Cold per message description, the parsed state lives in CANParser's per
+// message and per signal arrays indexed by slot and sig_begin.
+struct MessageState {
   std::string name;
   uint32_t address;
   unsigned int size;
 
-  std::vector<Signal> parse_sigs;
-  std::vector<double> vals;
-  std::vector<std::vector<double>> all_vals;
-
-  uint64_t last_seen_nanos;
-  uint64_t check_threshold;
-
-  uint8_t counter;
-  uint8_t counter_fail;
+  uint32_t sig_begin;
+  uint32_t num_sigs;
+  std::vector<uint32_t> checked_sigs;  // CHECKSUM/COUNTER signals validated before updating values
 
   bool ignore_checksum = false;
   bool ignore_counter = false;
-
-  bool parse(uint64_t nanos, const std::vector<uint8_t> &dat);
-  bool update_counter_generic(int64_t v, int cnt_size);
 };
 
 class CANParser {
@@ -64,7 +161,33 @@ private:
   kj::Array<capnp::word> aligned_buf;
 
   const DBC *dbc = NULL;
-  std::unordered_map<uint32_t, MessageState> message_states;
+  AddressIndex address_index;
+  std::vector<MessageState> message_states;
+
+  // per message state, indexed by slot
+  std::vector<uint32_t> history_size;
+  std::vector<uint32_t> history_capacity;
+  std::vector<uint64_t> last_seen_nanos;
+  std::vector<uint64_t> check_threshold;
+  std::vector<uint8_t> counter;
+  std::vector<uint8_t> counter_fail;
+
+  // per signal state, indexed by MessageState::sig_begin + i
+  std::vector<Signal> signals;
+  std::vector<SignalExtractor> extractors;
+  std::vector<double> vals;
+  // values received since the last query, per slot: history_capacity[slot] values for
+  // each of the message's signals. It doubles when full, so no value is dropped.
+  std::vector<std::vector<double>> history;
+
+  void init_state();
+
+  friend class CANParserGroup;
+
+  MessageState &add_message(const Msg &msg, uint64_t threshold);
+  bool parse(int slot, uint64_t nanos, const uint8_t *dat, size_t dat_size);
+  bool update_counter_generic(int slot, int64_t v, int cnt_size);
+  void update_bus_timeout(uint64_t nanos, bool bus_empty);
 
 public:
   bool can_valid = false;
@@ -81,22 +204,65 @@ public:
   #ifndef DYNAMIC_CAPNP
   void update_string(const std::string &data, bool sendcan);
   void update_strings(const std::vector<std::string> &data, std::vector<SignalValue> &vals, bool sendcan);
+  void update_strings(const std::vector<std::string> &data, std::vector<SignalValueView> &views, bool sendcan);
   void UpdateCans(uint64_t nanos, const capnp::List<cereal::CanData>::Reader& cans);
   #endif
   void UpdateCans(uint64_t nanos, const capnp::DynamicStruct::Reader& cans);
+  bool UpdateFrame(uint64_t nanos, uint32_t address, const uint8_t *dat, size_t dat_size);
   void UpdateValid(uint64_t nanos);
   void query_latest(std::vector<SignalValue> &vals, uint64_t last_ts = 0);
+  void query_latest(std::vector<SignalValueView> &views, uint64_t last_ts = 0);
+};
+
+// Decodes each can/sendcan event once for several parsers (e.g. pt, cam and
+// radar buses) and dispatches its frames to the parsers listening on their bus
+class CANParserGroup {
+private:
+  kj::Array<capnp::word> aligned_buf;
+  std::vector<CANParser *> parsers;
+  std::vector<std::vector<int>> bus_parsers;  // parser indices, indexed by src
+  std::vector<bool> bus_empty;
+
+public:
+  CANParserGroup(const std::vector<CANParser *> &parser_list);
+  #ifndef DYNAMIC_CAPNP
+  void update_string(const std::string &data, bool sendcan);
+  // returns the mono time of the first event, to be passed to each parser's query_latest
+  uint64_t update_strings(const std::vector<std::string> &data, bool sendcan);
+  #endif
 };
 
 class CANPacker {
 private:
+  // message with its signals resolved once by prepare_message()
+  struct PreparedMessage {
+    uint32_t address;
+    unsigned int size;
+    std::vector<std::pair<int, SignalExtractor>> sigs;  // (index into values, signal)
+
+    uint32_t *counter = nullptr;  // set if the message has a COUNTER
+    SignalExtractor counter_sig;
+    int counter_value = -1;  // index into values if the caller sets COUNTER, auto incremented otherwise
+
+    const Signal *checksum_sig = nullptr;  // set if the message has a CHECKSUM
+    SignalExtractor checksum_extractor;
+  };
+
   const DBC *dbc = NULL;
   std::map<std::pair<uint32_t, std::string>, Signal> signal_lookup;
   std::map<uint32_t, Msg> message_lookup;
   std::map<uint32_t, uint32_t> counters;
+  std::vector<PreparedMessage> prepared;
 
 public:
   CANPacker(const std::string& dbc_name);
   std::vector<uint8_t> pack(uint32_t address, const std::vector<SignalPackValue> &values);
   Msg* lookup_message(uint32_t address);
+
+  // Resolves a message and the names of the signals to set into a handle for
+  // pack_prepared(). Unknown signals are warned about once and ignored.
+  int prepare_message(uint32_t address, const std::vector<std::string> &signal_names);
+  // values are in the order of the names given to prepare_message(), out must
+  // hold the message size. Returns the number of bytes written.
+  size_t pack_prepared(int handle, const double *values, uint8_t *out);
 };
@@ -8,7 +8,7 @@ from libcpp.string cimport string
 from libcpp.vector cimport vector
 
 
-ctypedef unsigned int (*calc_checksum_type)(uint32_t, const Signal&, const vector[uint8_t] &)
+ctypedef unsigned int (*calc_checksum_type)(uint32_t, const Signal&, const uint8_t *, size_t)
 
 cdef extern from "common_dbc.h":
   ctypedef enum SignalType:
@@ -56,6 +56,14 @@ cdef extern from "common_dbc.h":
     double value
     vector[double] all_values
 
+  cdef struct SignalValueView:
+    uint32_t address
+    uint32_t sig_index
+    uint64_t ts_nanos
+    double value
+    const double *all_values
+    size_t all_values_size
+
   cdef struct SignalPackValue:
     string name
     double value
@@ -69,7 +77,15 @@ cdef extern from "common.h":
     bool bus_timeout
     CANParser(int, string, vector[pair[uint32_t, int]]) except +
     void update_strings(vector[string]&, vector[SignalValue]&, bool) except +
+    void update_strings(vector[string]&, vector[SignalValueView]&, bool) except +
+    void query_latest(vector[SignalValueView]&, uint64_t)
+
+  cdef cppclass CANParserGroup:
+    CANParserGroup(vector[CANParser *]) except +
+    uint64_t update_strings(vector[string]&, bool) except +
 
   cdef cppclass CANPacker:
    CANPacker(string)
    vector[uint8_t] pack(uint32_t, vector[SignalPackValue]&)
+   int prepare_message(uint32_t, vector[string]&)
+   size_t pack_prepared(int, const double *, uint8_t *)
@@ -18,6 +18,16 @@ struct SignalValue {
   std::vector<double> all_values;  // all values from this cycle
 };
 
+// Borrowed view of a signal's latest values, valid until the parser is updated again
+struct SignalValueView {
+  uint32_t address;
+  uint32_t sig_index;  // index into the message's signals in the DBC
+  uint64_t ts_nanos;
+  double value;  // latest value
+  const double *all_values;  // all values from this cycle
+  size_t all_values_size;
+};
+
 enum SignalType {
   DEFAULT,
   COUNTER,
@@ -38,7 +48,7 @@ struct Signal {
   double factor, offset;
   bool is_little_endian;
   SignalType type;
-  unsigned int (*calc_checksum)(uint32_t address, const Signal &sig, const std::vector<uint8_t> &d);
+  unsigned int (*calc_checksum)(uint32_t address, const Signal &sig, const uint8_t *d, size_t size);
 };
 
 struct Msg {
@@ -68,10 +78,10 @@ typedef struct ChecksumState {
   int counter_start_bit;
   bool little_endian;
   SignalType checksum_type;
-  unsigned int (*calc_checksum)(uint32_t address, const Signal &sig, const std::vector<uint8_t> &d);
+  unsigned int (*calc_checksum)(uint32_t address, const Signal &sig, const uint8_t *d, size_t size);
 } ChecksumState;
 
-DBC* dbc_parse(const std::string& dbc_path);
+DBC* dbc_parse(const std::string& dbc_path, bool use_cache = true);
 DBC* dbc_parse_from_stream(const std::string &dbc_name, std::istream &stream, ChecksumState *checksum = nullptr, bool allow_duplicate_msg_name=false);
 const DBC* dbc_lookup(const std::string& dbc_name);
 std::vector<std::string> get_dbc_names();
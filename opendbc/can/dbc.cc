@@ -2,23 +2,25 @@
 #include <filesystem>
 #include <fstream>
 #include <map>
-#include <regex>
 #include <set>
 #include <sstream>
+#include <string_view>
 #include <vector>
 #include <mutex>
 #include <iterator>
 #include <cstring>
 #include <clocale>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "opendbc/can/common.h"
 #include "opendbc/can/common_dbc.h"
 
-std::regex bo_regexp(R"(^BO_ (\w+) (\w+) *: (\w+) (\w+))");
-std::regex sg_regexp(R"(^SG_ (\w+) : (\d+)\|(\d+)@(\d+)([\+|\-]) \(([0-9.+\-eE]+),([0-9.+\-eE]+)\) \[([0-9.+\-eE]+)\|([0-9.+\-eE]+)\] \"(.*)\" (.*))");
-std::regex sgm_regexp(R"(^SG_ (\w+) (\w+) *: (\d+)\|(\d+)@(\d+)([\+|\-]) \(([0-9.+\-eE]+),([0-9.+\-eE]+)\) \[([0-9.+\-eE]+)\|([0-9.+\-eE]+)\] \"(.*)\" (.*))");
-std::regex val_regexp(R"(VAL_ (\w+) (\w+) (\s*[-+]?[0-9]+\s+\".+?\"[^;]*))");
-std::regex val_split_regexp{R"([\"]+)"};  // split on "
+// bump when the parser output or the cache layout changes
+#define DBC_CACHE_VERSION 1
 
 #define DBC_ASSERT(condition, message)                             \
   do {                                                             \
@@ -49,6 +51,123 @@ inline std::string& trim(std::string& s, const char* t = " \t\n\r\f\v") {
   return s.erase(0, s.find_first_not_of(t));
 }
 
+// Cursor over a single DBC line, matching the grammar of the BO_, SG_ and VAL_ lines we use
+class LineTokenizer {
+public:
+  LineTokenizer(std::string_view line) : s(line) {}
+
+  bool literal(std::string_view lit) {
+    if (s.compare(pos, lit.size(), lit) != 0) return false;
+    pos += lit.size();
+    return true;
+  }
+  bool word(std::string &out) {  // \w+
+    return token(out, [](char c) { return std::isalnum((unsigned char)c) || c == '_'; });
+  }
+  bool digits(std::string &out) {  // \d+
+    return token(out, [](char c) { return c >= '0' && c <= '9'; });
+  }
+  bool number(std::string &out) {  // [0-9.+\-eE]+
+    return token(out, [](char c) { return (c >= '0' && c <= '9') || std::strchr(".+-eE", c) != nullptr; });
+  }
+  bool one_of(const char *chars, char &out) {
+    if (pos >= s.size() || std::strchr(chars, s[pos]) == nullptr) return false;
+    out = s[pos++];
+    return true;
+  }
+  void skip(char c) {
+    while (pos < s.size() && s[pos] == c) pos++;
+  }
+  void skip_whitespace() {
+    while (pos < s.size() && std::isspace((unsigned char)s[pos])) pos++;
+  }
+  bool find(std::string_view needle) {
+    return s.find(needle, pos) != std::string_view::npos;
+  }
+  bool at_end() const { return pos == s.size(); }
+  size_t position() const { return pos; }
+  void seek(size_t p) { pos = p; }
+  std::string_view line() const { return s; }
+
+private:
+  template <typename F>
+  bool token(std::string &out, F accept) {
+    size_t start = pos;
+    while (pos < s.size() && accept(s[pos])) pos++;
+    out.assign(s.substr(start, pos - start));
+    return pos > start;
+  }
+
+  std::string_view s;
+  size_t pos = 0;
+};
+
+// BO_ <address> <name> *: <size> <transmitter>
+bool parse_bo(LineTokenizer &t, std::string &address, std::string &name, std::string &size) {
+  std::string transmitter;
+  if (!t.literal("BO_ ") || !t.word(address) || !t.literal(" ") || !t.word(name)) return false;
+  t.skip(' ');
+  return t.literal(": ") && t.word(size) && t.literal(" ") && t.word(transmitter) && t.at_end();
+}
+
+// SG_ <name> [<mux>] : <start>|<size>@<endianness><sign> (<factor>,<offset>) [<min>|<max>] "<unit>" <receivers>
+bool parse_sg(LineTokenizer &t, std::string fields[7]) {
+  std::string mux, tmp;
+  char sign;
+  if (!t.literal("SG_ ") || !t.word(fields[0])) return false;
+  if (!t.literal(" : ")) {
+    if (!t.literal(" ") || !t.word(mux)) return false;
+    t.skip(' ');
+    if (!t.literal(": ")) return false;
+  }
+  if (!(t.digits(fields[1]) && t.literal("|") && t.digits(fields[2]) && t.literal("@") && t.digits(fields[3]) &&
+        t.one_of("+|-", sign) && t.literal(" (") && t.number(fields[5]) && t.literal(",") && t.number(fields[6]) &&
+        t.literal(") [") && t.number(tmp) && t.literal("|") && t.number(tmp) && t.literal("] \"") && t.find("\" "))) {
+    return false;
+  }
+  fields[4] = sign;
+  return true;
+}
+
+// VAL_ <address> <signal> <value> "<description>" ... ;
+bool parse_val(LineTokenizer &t, std::string &address, std::string &name, std::string &defvals) {
+  if (!t.literal("VAL_ ") || !t.word(address) || !t.literal(" ") || !t.word(name) || !t.literal(" ")) return false;
+
+  const size_t start = t.position();
+  std::string value;
+  char sign;
+  t.skip_whitespace();
+  t.one_of("+-", sign);
+  if (!t.digits(value)) return false;
+  const size_t value_end = t.position();
+  t.skip_whitespace();
+  if (t.position() == value_end || !t.literal("\"")) return false;
+  // at least one character of description before the closing quote
+  const size_t close = t.line().find('"', t.position() + 1);
+  if (close == std::string_view::npos) return false;
+
+  const size_t end = std::min(t.line().find(';', close), t.line().size());
+  defvals.assign(t.line().substr(start, end - start));
+  return true;
+}
+
+// splits on runs of '"', matching std::sregex_token_iterator with submatch -1
+std::vector<std::string> split_quotes(const std::string &str) {
+  std::vector<std::string> words;
+  size_t start = 0;
+  while (true) {
+    size_t quote = str.find('"', start);
+    if (quote == std::string::npos) {
+      if (start < str.size()) words.push_back(str.substr(start));
+      break;
+    }
+    words.push_back(str.substr(start, quote - start));
+    start = str.find_first_not_of('"', quote);
+    if (start == std::string::npos) break;
+  }
+  return words;
+}
+
 ChecksumState* get_checksum(const std::string& dbc_name) {
   ChecksumState* s = nullptr;
   if (startswith(dbc_name, {"honda_", "acura_"})) {
@@ -119,20 +238,20 @@ DBC* dbc_parse_from_stream(const std::string &dbc_name, std::istream &stream, Ch
 
   std::string line;
   int line_num = 0;
-  std::smatch match;
-  // TODO: see if we can speed up the regex statements in this loop, SG_ is specifically the slowest
   while (std::getline(stream, line)) {
     line = trim(line);
     line_num += 1;
+    LineTokenizer t(line);
     if (startswith(line, "BO_ ")) {
       // new group
-      bool ret = std::regex_match(line, match, bo_regexp);
+      std::string address_str, name, size;
+      bool ret = parse_bo(t, address_str, name, size);
       DBC_ASSERT(ret, "bad BO: " << line);
 
       Msg& msg = dbc->msgs.emplace_back();
-      address = msg.address = std::stoul(match[1].str());  // could be hex
-      msg.name = match[2].str();
-      msg.size = std::stoul(match[3].str());
+      address = msg.address = std::stoul(address_str);  // could be hex
+      msg.name = name;
+      msg.size = std::stoul(size);
 
       // check for duplicates
       DBC_ASSERT(address_set.find(address) == address_set.end(), "Duplicate message address: " << address << " (" << msg.name << ")");
@@ -144,27 +263,27 @@ DBC* dbc_parse_from_stream(const std::string &dbc_name, std::istream &stream, Ch
       }
     } else if (startswith(line, "SG_ ")) {
       // new signal
-      int offset = 0;
-      if (!std::regex_search(line, match, sg_regexp)) {
-        bool ret = std::regex_search(line, match, sgm_regexp);
-        DBC_ASSERT(ret, "bad SG: " << line);
-        offset = 1;
-      }
+      std::string fields[7];
+      bool ret = parse_sg(t, fields);
+      DBC_ASSERT(ret, "bad SG: " << line);
+
       Signal& sig = signals[address].emplace_back();
-      sig.name = match[1].str();
-      sig.start_bit = std::stoi(match[offset + 2].str());
-      sig.size = std::stoi(match[offset + 3].str());
-      sig.is_little_endian = std::stoi(match[offset + 4].str()) == 1;
-      sig.is_signed = match[offset + 5].str() == "-";
-      sig.factor = std::stod(match[offset + 6].str());
-      sig.offset = std::stod(match[offset + 7].str());
+      sig.name = fields[0];
+      sig.start_bit = std::stoi(fields[1]);
+      sig.size = std::stoi(fields[2]);
+      sig.is_little_endian = std::stoi(fields[3]) == 1;
+      sig.is_signed = fields[4] == "-";
+      sig.factor = std::stod(fields[5]);
+      sig.offset = std::stod(fields[6]);
       set_signal_type(sig, checksum, dbc_name, line_num);
       if (sig.is_little_endian) {
         sig.lsb = sig.start_bit;
         sig.msb = sig.start_bit + sig.size - 1;
       } else {
-        auto it = find(be_bits.begin(), be_bits.end(), sig.start_bit);
-        sig.lsb = be_bits[(it - be_bits.begin()) + sig.size - 1];
+        // index of start_bit in be_bits
+        const int idx = (sig.start_bit / 8) * 8 + (7 - sig.start_bit % 8);
+        DBC_ASSERT(sig.start_bit >= 0 && idx + sig.size - 1 < be_bits.size(), "Signal out of bounds: " << line);
+        sig.lsb = be_bits[idx + sig.size - 1];
         sig.msb = sig.start_bit;
       }
       DBC_ASSERT(sig.lsb < (64 * 8) && sig.msb < (64 * 8), "Signal out of bounds: " << line);
@@ -174,17 +293,16 @@ DBC* dbc_parse_from_stream(const std::string &dbc_name, std::istream &stream, Ch
       signal_name_sets[address].insert(sig.name);
     } else if (startswith(line, "VAL_ ")) {
       // new signal value/definition
-      bool ret = std::regex_search(line, match, val_regexp);
+      std::string address_str, name, defvals;
+      bool ret = parse_val(t, address_str, name, defvals);
       DBC_ASSERT(ret, "bad VAL: " << line);
 
       auto& val = dbc->vals.emplace_back();
-      val.address = std::stoul(match[1].str());  // could be hex
-      val.name = match[2].str();
+      val.address = std::stoul(address_str);  // could be hex
+      val.name = name;
 
-      auto defvals = match[3].str();
-      std::sregex_token_iterator it{defvals.begin(), defvals.end(), val_split_regexp, -1};
       // convert strings to UPPER_CASE_WITH_UNDERSCORES
-      std::vector<std::string> words{it, {}};
+      std::vector<std::string> words = split_quotes(defvals);
       for (auto& w : words) {
         w = trim(w);
         std::transform(w.begin(), w.end(), w.begin(), ::toupper);
@@ -207,14 +325,264 @@ DBC* dbc_parse_from_stream(const std::string &dbc_name, std::istream &stream, Ch
   return dbc;
 }
 
-DBC* dbc_parse(const std::string& dbc_path) {
+// Binary cache of parsed DBCs, keyed by the DBC file's contents. Loading it is a
+// single mmap and a linear decode instead of a full text parse. The cache lives in
+// $DBC_CACHE_DIR if set, an empty DBC_CACHE_DIR disables it. Otherwise it's in the user's
+// cache directory, or in a private <tmp>/opendbc_cache_<uid> when there is no home.
+
+// The cache is not trusted, a signal is only loaded from it if it fits in its message of msg_size bytes
+// and its bit positions match what the text parser derives from start_bit and size
+static bool cache_signal_valid(const Signal &sig, uint32_t msg_size) {
+  const int bits = std::min(msg_size, 64U) * 8;
+  if (sig.size < 1 || sig.size > 64 || sig.start_bit < 0 || sig.start_bit >= bits) return false;
+
+  int lsb, msb;
+  if (sig.is_little_endian) {
+    lsb = sig.start_bit;
+    msb = sig.start_bit + sig.size - 1;
+  } else {
+    // index of the lsb in big endian bit order, see be_bits in dbc_parse_from_stream
+    const int idx = (sig.start_bit / 8) * 8 + (7 - sig.start_bit % 8) + sig.size - 1;
+    lsb = (idx / 8) * 8 + (7 - idx % 8);
+    msb = sig.start_bit;
+  }
+  return sig.lsb == lsb && sig.msb == msb && lsb < bits && msb < bits;
+}
+
+class CacheWriter {
+public:
+  template <typename T>
+  void pod(const T &v) { buf.append((const char *)&v, sizeof(T)); }
+  void str(const std::string &v) {
+    pod<uint32_t>(v.size());
+    buf.append(v);
+  }
+  void signals(const std::vector<Signal> &sigs) {
+    pod<uint32_t>(sigs.size());
+    for (const auto &sig : sigs) {
+      str(sig.name);
+      pod(sig.start_bit); pod(sig.msb); pod(sig.lsb); pod(sig.size);
+      pod(sig.is_signed); pod(sig.factor); pod(sig.offset); pod(sig.is_little_endian);
+      pod<int32_t>(sig.type);
+      pod<bool>(sig.calc_checksum != nullptr);
+    }
+  }
+  std::string buf;
+};
+
+class CacheReader {
+public:
+  CacheReader(const char *data, size_t size) : p(data), end(data + size) {}
+
+  template <typename T>
+  T pod() {
+    T v = {};
+    if (end - p < sizeof(T)) {
+      ok = false;
+      return v;
+    }
+    memcpy(&v, p, sizeof(T));
+    p += sizeof(T);
+    return v;
+  }
+  bool flag() {
+    uint8_t v = pod<uint8_t>();
+    ok = ok && v <= 1;
+    return v == 1;
+  }
+  std::string str() {
+    uint32_t size = pod<uint32_t>();
+    if (!ok || end - p < size) {
+      ok = false;
+      return {};
+    }
+    std::string v(p, size);
+    p += size;
+    return v;
+  }
+  // element count, every element takes at least one byte
+  uint32_t count() {
+    uint32_t n = pod<uint32_t>();
+    if (n > end - p) {
+      ok = false;
+      return 0;
+    }
+    return n;
+  }
+  std::vector<Signal> signals(const ChecksumState *checksum, uint32_t msg_size) {
+    std::vector<Signal> sigs(count());
+    for (int i = 0; ok && i < sigs.size(); i++) {
+      Signal &sig = sigs[i];
+      sig.name = str();
+      sig.start_bit = pod<int>(); sig.msb = pod<int>(); sig.lsb = pod<int>(); sig.size = pod<int>();
+      sig.is_signed = flag(); sig.factor = pod<double>(); sig.offset = pod<double>(); sig.is_little_endian = flag();
+      int32_t type = pod<int32_t>();
+      sig.type = (SignalType)type;
+      sig.calc_checksum = (flag() && checksum) ? checksum->calc_checksum : nullptr;
+      ok = ok && type >= DEFAULT && type <= HKG_CAN_FD_CHECKSUM && (type <= COUNTER || sig.calc_checksum != nullptr) &&
+           cache_signal_valid(sig, msg_size);
+    }
+    return sigs;
+  }
+  bool done() const { return ok && p == end; }
+
+  bool ok = true;
+
+private:
+  const char *p, *end;
+};
+
+const uint32_t DBC_CACHE_MAGIC = 0x43434244;  // "DBCC"
+
+uint64_t fnv1a_hash(const std::string &data) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (unsigned char c : data) {
+    hash = (hash ^ c) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+// a shared directory is only used if this user owns it and nobody else can write to it
+static bool private_dir(const std::filesystem::path &dir) {
+  mkdir(dir.c_str(), 0700);
+  struct stat st;
+  return lstat(dir.c_str(), &st) == 0 && S_ISDIR(st.st_mode) && st.st_uid == getuid() && (st.st_mode & (S_IWGRP | S_IWOTH)) == 0;
+}
+
+std::filesystem::path dbc_cache_dir() {
+  if (const char *env = std::getenv("DBC_CACHE_DIR")) return env;
+
+  const char *xdg_cache = std::getenv("XDG_CACHE_HOME");
+  if (xdg_cache && xdg_cache[0] == '/') return std::filesystem::path(xdg_cache) / "opendbc";
+  const char *home = std::getenv("HOME");
+  if (home && home[0] == '/') return std::filesystem::path(home) / ".cache" / "opendbc";
+
+  std::error_code ec;
+  std::filesystem::path tmp = std::filesystem::temp_directory_path(ec);
+  if (ec) return {};
+  std::filesystem::path dir = tmp / ("opendbc_cache_" + std::to_string(getuid()));
+  return private_dir(dir) ? dir : std::filesystem::path();
+}
+
+std::string dbc_cache_path(const std::string &dbc_name, uint64_t hash) {
+  const std::filesystem::path dir = dbc_cache_dir();
+  if (dir.empty()) return "";
+
+  char hash_str[17];
+  snprintf(hash_str, sizeof(hash_str), "%016llx", (unsigned long long)hash);
+  return (dir / (dbc_name + "." + hash_str + ".bin")).string();
+}
+
+DBC* dbc_load_cache(const std::string &cache_path, const std::string &dbc_name, uint64_t hash, const ChecksumState *checksum) {
+  int fd = open(cache_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return nullptr;
+
+  struct stat st;
+  void *data = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (data == MAP_FAILED) return nullptr;
+
+  CacheReader r((const char *)data, st.st_size);
+  DBC *dbc = nullptr;
+  if (r.pod<uint32_t>() == DBC_CACHE_MAGIC && r.pod<uint32_t>() == DBC_CACHE_VERSION && r.pod<uint64_t>() == hash) {
+    dbc = new DBC;
+    dbc->name = dbc_name;
+    dbc->msgs.resize(r.count());
+    for (int i = 0; r.ok && i < dbc->msgs.size(); i++) {
+      Msg &msg = dbc->msgs[i];
+      msg.name = r.str();
+      msg.address = r.pod<uint32_t>();
+      msg.size = r.pod<uint32_t>();
+      msg.sigs = r.signals(checksum, msg.size);
+    }
+    dbc->vals.resize(r.count());
+    for (int i = 0; r.ok && i < dbc->vals.size(); i++) {
+      Val &val = dbc->vals[i];
+      val.name = r.str();
+      val.address = r.pod<uint32_t>();
+      val.def_val = r.str();
+      val.sigs = r.signals(checksum, 64);
+    }
+    if (!r.done()) {
+      delete dbc;
+      dbc = nullptr;
+    }
+  }
+  munmap(data, st.st_size);
+  return dbc;
+}
+
+void dbc_save_cache(const std::string &cache_path, const DBC *dbc, uint64_t hash) {
+  // DBCs with signals outside their message would be rejected on load, they're parsed from text every time
+  for (const auto &msg : dbc->msgs) {
+    for (const auto &sig : msg.sigs) {
+      if (!cache_signal_valid(sig, msg.size)) return;
+    }
+  }
+  for (const auto &val : dbc->vals) {
+    for (const auto &sig : val.sigs) {
+      if (!cache_signal_valid(sig, 64)) return;
+    }
+  }
+
+  CacheWriter w;
+  w.pod(DBC_CACHE_MAGIC);
+  w.pod<uint32_t>(DBC_CACHE_VERSION);
+  w.pod(hash);
+  w.pod<uint32_t>(dbc->msgs.size());
+  for (const auto &msg : dbc->msgs) {
+    w.str(msg.name);
+    w.pod<uint32_t>(msg.address);
+    w.pod<uint32_t>(msg.size);
+    w.signals(msg.sigs);
+  }
+  w.pod<uint32_t>(dbc->vals.size());
+  for (const auto &val : dbc->vals) {
+    w.str(val.name);
+    w.pod<uint32_t>(val.address);
+    w.str(val.def_val);
+    w.signals(val.sigs);
+  }
+
+  // write to a temporary file and rename, so concurrent readers never see a partial cache
+  std::error_code ec;
+  std::filesystem::create_directories(std::filesystem::path(cache_path).parent_path(), ec);
+  const std::string tmp_path = cache_path + "." + std::to_string(getpid()) + ".tmp";
+  std::ofstream out(tmp_path, std::ios::binary);
+  if (!out) return;
+  out.write(w.buf.data(), w.buf.size());
+  out.close();
+  if (!out || std::rename(tmp_path.c_str(), cache_path.c_str()) != 0) {
+    std::remove(tmp_path.c_str());
+  }
+}
+
+DBC* dbc_parse(const std::string& dbc_path, bool use_cache) {
   std::ifstream infile(dbc_path);
   if (!infile) return nullptr;
 
-  const std::string dbc_name = std::filesystem::path(dbc_path).filename();
+  std::stringstream content;
+  content << infile.rdbuf();
 
+  const std::string dbc_name = std::filesystem::path(dbc_path).filename();
   std::unique_ptr<ChecksumState> checksum(get_checksum(dbc_name));
-  return dbc_parse_from_stream(dbc_name, infile, checksum.get());
+
+  const uint64_t hash = fnv1a_hash(content.str());
+  const std::string cache_path = use_cache ? dbc_cache_path(dbc_name, hash) : "";
+  if (!cache_path.empty()) {
+    if (DBC *dbc = dbc_load_cache(cache_path, dbc_name, hash, checksum.get())) {
+      return dbc;
+    }
+  }
+
+  DBC *dbc = dbc_parse_from_stream(dbc_name, content, checksum.get());
+  if (!cache_path.empty()) {
+    dbc_save_cache(cache_path, dbc, hash);
+  }
+  return dbc;
 }
 
 const std::string get_dbc_root_path() {
@@ -1,6 +1,7 @@
 #include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <cstring>
 #include <map>
 #include <stdexcept>
 #include <utility>
@@ -41,8 +42,17 @@ CANPacker::CANPacker(const std::string& dbc_name) {
   init_crc_lookup_tables();
 }
 
+static int64_t pack_signal_value(const SignalExtractor &sig, double value) {
+  int64_t ival = (int64_t)(round((value - sig.offset) / sig.factor));
+  if (ival < 0) {
+    ival = (1ULL << sig.size) + ival;
+  }
+  return ival;
+}
+
 std::vector<uint8_t> CANPacker::pack(uint32_t address, const std::vector<SignalPackValue> &signals) {
-  std::vector<uint8_t> ret(message_lookup[address].size, 0);
+  auto msg_it = message_lookup.find(address);
+  std::vector<uint8_t> ret(msg_it != message_lookup.end() ? msg_it->second.size : 0, 0);
 
   // set all values for all given signal/value pairs
   bool counter_set = false;
@@ -61,9 +71,9 @@ std::vector<uint8_t> CANPacker::pack(uint32_t address, const std::vector<SignalP
     }
     set_value(ret, sig, ival);
 
-    counter_set = counter_set || (sigval.name == "COUNTER");
-    if (counter_set) {
+    if (sigval.name == "COUNTER") {
       counters[address] = sigval.value;
+      counter_set = true;
     }
   }
 
@@ -84,7 +94,7 @@ std::vector<uint8_t> CANPacker::pack(uint32_t address, const std::vector<SignalP
   if (sig_it_checksum != signal_lookup.end()) {
     const auto &sig = sig_it_checksum->second;
     if (sig.calc_checksum != nullptr) {
-      unsigned int checksum = sig.calc_checksum(address, sig, ret);
+      unsigned int checksum = sig.calc_checksum(address, sig, ret.data(), ret.size());
       set_value(ret, sig, checksum);
     }
   }
@@ -92,6 +102,66 @@ std::vector<uint8_t> CANPacker::pack(uint32_t address, const std::vector<SignalP
   return ret;
 }
 
+int CANPacker::prepare_message(uint32_t address, const std::vector<std::string> &signal_names) {
+  PreparedMessage &m = prepared.emplace_back();
+  m.address = address;
+  auto msg_it = message_lookup.find(address);
+  m.size = msg_it != message_lookup.end() ? msg_it->second.size : 0;
+
+  for (int i = 0; i < signal_names.size(); i++) {
+    auto sig_it = signal_lookup.find(std::make_pair(address, signal_names[i]));
+    if (sig_it == signal_lookup.end()) {
+      WARN("undefined signal %s - %d\n", signal_names[i].c_str(), address);
+      continue;
+    }
+    m.sigs.emplace_back(i, SignalExtractor(sig_it->second));
+    if (signal_names[i] == "COUNTER") {
+      m.counter_value = i;
+    }
+  }
+
+  auto sig_it_counter = signal_lookup.find(std::make_pair(address, "COUNTER"));
+  if (sig_it_counter != signal_lookup.end()) {
+    m.counter_sig = SignalExtractor(sig_it_counter->second);
+    m.counter = &counters[address];
+  }
+
+  auto sig_it_checksum = signal_lookup.find(std::make_pair(address, "CHECKSUM"));
+  if (sig_it_checksum != signal_lookup.end() && sig_it_checksum->second.calc_checksum != nullptr) {
+    m.checksum_sig = &sig_it_checksum->second;
+    m.checksum_extractor = SignalExtractor(sig_it_checksum->second);
+  }
+  return prepared.size() - 1;
+}
+
+size_t CANPacker::pack_prepared(int handle, const double *values, uint8_t *out) {
+  const PreparedMessage &m = prepared[handle];
+  uint8_t buf[CAN_PADDED_DATA_SIZE] = {};
+
+  for (const auto &[value_idx, sig] : m.sigs) {
+    sig.insert(buf, pack_signal_value(sig, values[value_idx]));
+  }
+
+  // set message counter
+  if (m.counter != nullptr) {
+    if (m.counter_value >= 0) {
+      *m.counter = values[m.counter_value];
+    } else {
+      const auto &sig = m.counter_sig;
+      sig.insert(buf, *m.counter);
+      *m.counter = (*m.counter + 1) % (1 << sig.size);
+    }
+  }
+
+  // set message checksum
+  if (m.checksum_sig != nullptr) {
+    m.checksum_extractor.insert(buf, m.checksum_sig->calc_checksum(m.address, *m.checksum_sig, buf, m.size));
+  }
+
+  memcpy(out, buf, m.size);
+  return m.size;
+}
+
 // This function has a definition in common.h and is used in PlotJuggler
 Msg* CANPacker::lookup_message(uint32_t address) {
   return &message_lookup[address];
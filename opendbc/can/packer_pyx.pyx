@@ -7,7 +7,7 @@ from libcpp.map cimport map
 from libcpp.string cimport string
 
 from .common cimport CANPacker as cpp_CANPacker
-from .common cimport dbc_lookup, SignalPackValue, DBC
+from .common cimport dbc_lookup, DBC
 
 
 cdef class CANPacker:
@@ -15,6 +15,8 @@ cdef class CANPacker:
     cpp_CANPacker *packer
     const DBC *dbc
     map[string, int] name_to_address
+    dict prepared
+    vector[double] values_buf
 
   def __init__(self, dbc_name):
     self.dbc = dbc_lookup(dbc_name)
@@ -22,6 +24,7 @@ cdef class CANPacker:
       raise RuntimeError(f"Can't lookup {dbc_name}")
 
     self.packer = new cpp_CANPacker(dbc_name)
+    self.prepared = {}
     for i in range(self.dbc[0].msgs.size()):
       msg = self.dbc[0].msgs[i]
       self.name_to_address[string(msg.name)] = msg.address
@@ -30,18 +33,6 @@ cdef class CANPacker:
     if self.packer:
       del self.packer
 
-  cdef vector[uint8_t] pack(self, addr, values):
-    cdef vector[SignalPackValue] values_thing
-    values_thing.reserve(len(values))
-    cdef SignalPackValue spv
-
-    for name, value in values.iteritems():
-      spv.name = name.encode("utf8")
-      spv.value = value
-      values_thing.push_back(spv)
-
-    return self.packer.pack(addr, values_thing)
-
   cpdef make_can_msg(self, name_or_addr, bus, values):
     cdef int addr
     if isinstance(name_or_addr, int):
@@ -49,5 +40,17 @@ cdef class CANPacker:
     else:
       addr = self.name_to_address[name_or_addr.encode("utf8")]
 
-    cdef vector[uint8_t] val = self.pack(addr, values)
-    return [addr, 0, (<char *>&val[0])[:val.size()], bus]
+    # resolve each (message, signal names) combination once, then pack by index
+    key = (addr, tuple(values))
+    handle = self.prepared.get(key)
+    if handle is None:
+      handle = self.packer.prepare_message(addr, [name.encode("utf8") for name in key[1]])
+      self.prepared[key] = handle
+
+    self.values_buf.clear()
+    for value in values.values():
+      self.values_buf.push_back(value)
+
+    cdef uint8_t dat[64]
+    cdef size_t size = self.packer.pack_prepared(handle, self.values_buf.data(), dat)
+    return [addr, 0, (<char *>dat)[:size], bus]
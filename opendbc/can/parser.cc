@@ -1,5 +1,6 @@
 #include <algorithm>
 #include <cassert>
+#include <cstdlib>
 #include <cstring>
 #include <limits>
 #include <stdexcept>
@@ -33,66 +34,135 @@ int64_t get_raw_value(const std::vector<uint8_t> &msg, const Signal &sig) {
 }
 
 
-bool MessageState::parse(uint64_t nanos, const std::vector<uint8_t> &dat) {
-  std::vector<double> tmp_vals(parse_sigs.size());
-  bool checksum_failed = false;
-  bool counter_failed = false;
+SignalExtractor::SignalExtractor(const Signal &sig) {
+  const int lsb_byte = sig.lsb / 8;
+  msb_byte = sig.msb / 8;
+  first_byte = std::min<int>(lsb_byte, msb_byte);
+  num_bytes = std::abs(msb_byte - lsb_byte) + 1;
+  shift = sig.lsb % 8;
+  size = sig.size;
+  is_little_endian = sig.is_little_endian;
+  is_signed = sig.is_signed;
+  mask = sig.size >= 64 ? ~0ULL : ((1ULL << sig.size) - 1);
+  factor = sig.factor;
+  offset = sig.offset;
+}
 
-  for (int i = 0; i < parse_sigs.size(); i++) {
-    const auto &sig = parse_sigs[i];
 
-    int64_t tmp = get_raw_value(dat, sig);
-    if (sig.is_signed) {
-      tmp -= ((tmp >> (sig.size-1)) & 0x1) ? (1ULL << sig.size) : 0;
-    }
+void AddressIndex::build(const std::vector<uint32_t> &addresses) {
+  // keep the load factor at or below 0.5 so probe sequences stay short
+  int bits = 1;
+  while ((1U << bits) < addresses.size() * 2) bits++;
 
-    //DEBUG("parse 0x%X %s -> %ld\n", address, sig.name, tmp);
+  entries.assign(1U << bits, {0, -1});
+  mask = (1U << bits) - 1;
+  hash_shift = 32 - bits;
+  for (int slot = 0; slot < addresses.size(); slot++) {
+    uint32_t i = hash(addresses[slot]);
+    while (entries[i].slot >= 0) i = (i + 1) & mask;
+    entries[i] = {addresses[slot], slot};
+  }
+}
 
-    if (!ignore_checksum) {
-      if (sig.calc_checksum != nullptr && sig.calc_checksum(address, sig, dat) != tmp) {
-        checksum_failed = true;
-      }
-    }
 
-    if (!ignore_counter) {
-      if (sig.type == SignalType::COUNTER && !update_counter_generic(tmp, sig.size)) {
-        counter_failed = true;
-      }
+bool CANParser::parse(int slot, uint64_t nanos, const uint8_t *dat, size_t dat_size) {
+  const MessageState &state = message_states[slot];
+  uint8_t buf[CAN_PADDED_DATA_SIZE] = {};
+  memcpy(buf, dat, dat_size);
+
+  // validate checksum and counter first, values are only updated if both are valid
+  bool checksum_failed = false;
+  bool counter_failed = false;
+  for (uint32_t i : state.checked_sigs) {
+    const Signal &sig = signals[i];
+    int64_t tmp = extractors[i].extract(buf, dat_size);
+
+    if (!state.ignore_checksum && sig.calc_checksum != nullptr && sig.calc_checksum(state.address, sig, dat, dat_size) != tmp) {
+      checksum_failed = true;
     }
 
-    tmp_vals[i] = tmp * sig.factor + sig.offset;
+    if (!state.ignore_counter && sig.type == SignalType::COUNTER && !update_counter_generic(slot, tmp, sig.size)) {
+      counter_failed = true;
+    }
   }
 
-  // only update values if both checksum and counter are valid
   if (checksum_failed || counter_failed) {
-    LOGE("0x%X message checks failed, checksum failed %d, counter failed %d", address, checksum_failed, counter_failed);
+    LOGE("0x%X message checks failed, checksum failed %d, counter failed %d", state.address, checksum_failed, counter_failed);
     return false;
   }
 
-  for (int i = 0; i < parse_sigs.size(); i++) {
-    vals[i] = tmp_vals[i];
-    all_vals[i].push_back(vals[i]);
+  uint32_t &pos = history_size[slot];
+  uint32_t &capacity = history_capacity[slot];
+  if (pos == capacity) {
+    // not queried for a while, keep every value
+    std::vector<double> grown(state.num_sigs * capacity * 2);
+    for (uint32_t j = 0; j < state.num_sigs; j++) {
+      std::copy_n(&history[slot][j * capacity], pos, &grown[j * capacity * 2]);
+    }
+    history[slot].swap(grown);
+    capacity *= 2;
+  }
+
+  double *h = history[slot].data() + pos;
+  for (uint32_t i = state.sig_begin; i < state.sig_begin + state.num_sigs; i++, h += capacity) {
+    vals[i] = extractors[i].decode(buf, dat_size);
+    *h = vals[i];
   }
-  last_seen_nanos = nanos;
+  pos++;
+  last_seen_nanos[slot] = nanos;
 
   return true;
 }
 
 
-bool MessageState::update_counter_generic(int64_t v, int cnt_size) {
-  if (((counter + 1) & ((1 << cnt_size) -1)) != v) {
-    counter_fail = std::min(counter_fail + 1, MAX_BAD_COUNTER);
-    if (counter_fail > 1) {
-      INFO("0x%X COUNTER FAIL #%d -- %d -> %d\n", address, counter_fail, counter, (int)v);
+bool CANParser::update_counter_generic(int slot, int64_t v, int cnt_size) {
+  uint8_t &cnt = counter[slot];
+  uint8_t &cnt_fail = counter_fail[slot];
+  if (((cnt + 1) & ((1 << cnt_size) -1)) != v) {
+    cnt_fail = std::min(cnt_fail + 1, MAX_BAD_COUNTER);
+    if (cnt_fail > 1) {
+      INFO("0x%X COUNTER FAIL #%d -- %d -> %d\n", message_states[slot].address, cnt_fail, cnt, (int)v);
     }
-  } else if (counter_fail > 0) {
-    counter_fail--;
+  } else if (cnt_fail > 0) {
+    cnt_fail--;
   }
-  counter = v;
-  return counter_fail < MAX_BAD_COUNTER;
+  cnt = v;
+  return cnt_fail < MAX_BAD_COUNTER;
 }
 
 
+MessageState &CANParser::add_message(const Msg &msg, uint64_t threshold) {
+  MessageState &state = message_states.emplace_back();
+  state.name = msg.name;
+  state.address = msg.address;
+  state.size = msg.size;
+  assert(state.size <= CAN_MAX_DATA_SIZE);  // max signal size is 64 bytes
+
+  // track all signals for this message
+  state.sig_begin = signals.size();
+  state.num_sigs = msg.sigs.size();
+  for (const auto &sig : msg.sigs) {
+    if (sig.calc_checksum != nullptr || sig.type == SignalType::COUNTER) {
+      state.checked_sigs.push_back(signals.size());
+    }
+    signals.push_back(sig);
+    extractors.emplace_back(sig);
+  }
+
+  history_size.push_back(0);
+  history_capacity.push_back(CAN_HISTORY_SIZE);
+  history.emplace_back(state.num_sigs * CAN_HISTORY_SIZE);
+  last_seen_nanos.push_back(0);
+  check_threshold.push_back(threshold);
+  counter.push_back(0);
+  counter_fail.push_back(0);
+  return state;
+}
+
+void CANParser::init_state() {
+  vals.resize(signals.size());
+}
+
 CANParser::CANParser(int abus, const std::string& dbc_name, const std::vector<std::pair<uint32_t, int>> &messages)
   : bus(abus), aligned_buf(kj::heapArray<capnp::word>(1024)) {
   dbc = dbc_lookup(dbc_name);
@@ -101,24 +171,23 @@ CANParser::CANParser(int abus, const std::string& dbc_name, const std::vector<st
 
   bus_timeout_threshold = std::numeric_limits<uint64_t>::max();
 
+  std::vector<uint32_t> addresses;
   for (const auto& [address, frequency] : messages) {
     // disallow duplicate message checks
-    if (message_states.find(address) != message_states.end()) {
+    if (std::find(addresses.begin(), addresses.end(), address) != addresses.end()) {
       std::stringstream is;
       is << "Duplicate Message Check: " << address;
       throw std::runtime_error(is.str());
     }
-
-    MessageState &state = message_states[address];
-    state.address = address;
-    // state.check_frequency = op.check_frequency,
+    addresses.push_back(address);
 
     // msg is not valid if a message isn't received for 10 consecutive steps
+    uint64_t threshold = 0;
     if (frequency > 0) {
-      state.check_threshold = (1000000000ULL / frequency) * 10;
+      threshold = (1000000000ULL / frequency) * 10;
 
       // bus timeout threshold should be 10x the fastest msg
-      bus_timeout_threshold = std::min(bus_timeout_threshold, state.check_threshold);
+      bus_timeout_threshold = std::min(bus_timeout_threshold, threshold);
     }
 
     const Msg* msg = NULL;
@@ -133,15 +202,11 @@ CANParser::CANParser(int abus, const std::string& dbc_name, const std::vector<st
       assert(false);
     }
 
-    state.name = msg->name;
-    state.size = msg->size;
-    assert(state.size <= 64);  // max signal size is 64 bytes
-
-    // track all signals for this message
-    state.parse_sigs = msg->sigs;
-    state.vals.resize(msg->sigs.size());
-    state.all_vals.resize(msg->sigs.size());
+    add_message(*msg, threshold);
   }
+
+  address_index.build(addresses);
+  init_state();
 }
 
 CANParser::CANParser(int abus, const std::string& dbc_name, bool ignore_checksum, bool ignore_counter)
@@ -152,23 +217,16 @@ CANParser::CANParser(int abus, const std::string& dbc_name, bool ignore_checksum
   assert(dbc);
   init_crc_lookup_tables();
 
+  std::vector<uint32_t> addresses;
   for (const auto& msg : dbc->msgs) {
-    MessageState state = {
-      .name = msg.name,
-      .address = msg.address,
-      .size = msg.size,
-      .ignore_checksum = ignore_checksum,
-      .ignore_counter = ignore_counter,
-    };
-
-    for (const auto& sig : msg.sigs) {
-      state.parse_sigs.push_back(sig);
-      state.vals.push_back(0);
-      state.all_vals.push_back({});
-    }
-
-    message_states[state.address] = state;
+    MessageState &state = add_message(msg, 0);
+    state.ignore_checksum = ignore_checksum;
+    state.ignore_counter = ignore_counter;
+    addresses.push_back(msg.address);
   }
+
+  address_index.build(addresses);
+  init_state();
 }
 
 #ifndef DYNAMIC_CAPNP
@@ -206,6 +264,17 @@ void CANParser::update_strings(const std::vector<std::string> &data, std::vector
   query_latest(vals, current_nanos);
 }
 
+void CANParser::update_strings(const std::vector<std::string> &data, std::vector<SignalValueView> &views, bool sendcan) {
+  uint64_t current_nanos = 0;
+  for (const auto &d : data) {
+    update_string(d, sendcan);
+    if (current_nanos == 0) {
+      current_nanos = last_nanos;
+    }
+  }
+  query_latest(views, current_nanos);
+}
+
 void CANParser::UpdateCans(uint64_t nanos, const capnp::List<cereal::CanData>::Reader& cans) {
   //DEBUG("got %d messages\n", cans.size());
 
@@ -219,37 +288,32 @@ void CANParser::UpdateCans(uint64_t nanos, const capnp::List<cereal::CanData>::R
     }
     bus_empty = false;
 
-    auto state_it = message_states.find(cmsg.getAddress());
-    if (state_it == message_states.end()) {
-      // DEBUG("skip %d: not specified\n", cmsg.getAddress());
-      continue;
-    }
-
     auto dat = cmsg.getDat();
 
-    if (dat.size() > 64) {
+    if (dat.size() > CAN_MAX_DATA_SIZE) {
       DEBUG("got message longer than 64 bytes: 0x%X %zu\n", cmsg.getAddress(), dat.size());
       continue;
     }
 
     // TODO: this actually triggers for some cars. fix and enable this
-    //if (dat.size() != state_it->second.size) {
-    //  DEBUG("got message with unexpected length: expected %d, got %zu for %d", state_it->second.size, dat.size(), cmsg.getAddress());
+    //if (dat.size() != state.size) {
+    //  DEBUG("got message with unexpected length: expected %d, got %zu for %d", state.size, dat.size(), cmsg.getAddress());
     //  continue;
     //}
 
-    std::vector<uint8_t> data(dat.size(), 0);
-    memcpy(data.data(), dat.begin(), dat.size());
-    state_it->second.parse(nanos, data);
+    UpdateFrame(nanos, cmsg.getAddress(), dat.begin(), dat.size());
   }
 
-  // update bus timeout
+  update_bus_timeout(nanos, bus_empty);
+}
+#endif
+
+void CANParser::update_bus_timeout(uint64_t nanos, bool bus_empty) {
   if (!bus_empty) {
     last_nonempty_nanos = nanos;
   }
   bus_timeout = (nanos - last_nonempty_nanos) > bus_timeout_threshold;
 }
-#endif
 
 void CANParser::UpdateCans(uint64_t nanos, const capnp::DynamicStruct::Reader& cmsg) {
   // assume message struct is `cereal::CanData` and parse
@@ -260,17 +324,18 @@ void CANParser::UpdateCans(uint64_t nanos, const capnp::DynamicStruct::Reader& c
     return;
   }
 
-  auto state_it = message_states.find(cmsg.get("address").as<uint32_t>());
-  if (state_it == message_states.end()) {
-    DEBUG("skip %d: not specified\n", cmsg.get("address").as<uint32_t>());
-    return;
-  }
-
   auto dat = cmsg.get("dat").as<capnp::Data>();
-  if (dat.size() > 64) return; // shouldn't ever happen
-  std::vector<uint8_t> data(dat.size(), 0);
-  memcpy(data.data(), dat.begin(), dat.size());
-  state_it->second.parse(nanos, data);
+  if (dat.size() > CAN_MAX_DATA_SIZE) return; // shouldn't ever happen
+  UpdateFrame(nanos, cmsg.get("address").as<uint32_t>(), dat.begin(), dat.size());
+}
+
+bool CANParser::UpdateFrame(uint64_t nanos, uint32_t address, const uint8_t *dat, size_t dat_size) {
+  int slot = address_index.find(address);
+  if (slot < 0) {
+    // DEBUG("skip %d: not specified\n", address);
+    return false;
+  }
+  return parse(slot, nanos, dat, dat_size);
 }
 
 void CANParser::UpdateValid(uint64_t nanos) {
@@ -278,17 +343,16 @@ void CANParser::UpdateValid(uint64_t nanos) {
 
   bool _valid = true;
   bool _counters_valid = true;
-  for (const auto& kv : message_states) {
-    const auto& state = kv.second;
-
-    if (state.counter_fail >= MAX_BAD_COUNTER) {
+  for (int slot = 0; slot < message_states.size(); slot++) {
+    if (counter_fail[slot] >= MAX_BAD_COUNTER) {
       _counters_valid = false;
     }
 
-    const bool missing = state.last_seen_nanos == 0;
-    const bool timed_out = (nanos - state.last_seen_nanos) > state.check_threshold;
-    if (state.check_threshold > 0 && (missing || timed_out)) {
+    const bool missing = last_seen_nanos[slot] == 0;
+    const bool timed_out = (nanos - last_seen_nanos[slot]) > check_threshold[slot];
+    if (check_threshold[slot] > 0 && (missing || timed_out)) {
       if (show_missing && !bus_timeout) {
+        const auto &state = message_states[slot];
         if (missing) {
           LOGE("0x%X '%s' NOT SEEN", state.address, state.name.c_str());
         } else if (timed_out) {
@@ -306,21 +370,116 @@ void CANParser::query_latest(std::vector<SignalValue> &vals, uint64_t last_ts) {
   if (last_ts == 0) {
     last_ts = last_nanos;
   }
-  for (auto& kv : message_states) {
-    auto& state = kv.second;
-    if (last_ts != 0 && state.last_seen_nanos < last_ts) {
+  for (int slot = 0; slot < message_states.size(); slot++) {
+    const auto &state = message_states[slot];
+    if (last_ts != 0 && last_seen_nanos[slot] < last_ts) {
       continue;
     }
 
-    for (int i = 0; i < state.parse_sigs.size(); i++) {
-      const Signal &sig = state.parse_sigs[i];
+    for (uint32_t i = state.sig_begin; i < state.sig_begin + state.num_sigs; i++) {
       SignalValue &v = vals.emplace_back();
       v.address = state.address;
-      v.ts_nanos = state.last_seen_nanos;
-      v.name = sig.name;
-      v.value = state.vals[i];
-      v.all_values = state.all_vals[i];
-      state.all_vals[i].clear();
+      v.ts_nanos = last_seen_nanos[slot];
+      v.name = signals[i].name;
+      v.value = this->vals[i];
+      const double *h = &history[slot][(i - state.sig_begin) * history_capacity[slot]];
+      v.all_values.assign(h, h + history_size[slot]);
+    }
+    history_size[slot] = 0;
+  }
+}
+
+void CANParser::query_latest(std::vector<SignalValueView> &views, uint64_t last_ts) {
+  if (last_ts == 0) {
+    last_ts = last_nanos;
+  }
+  for (int slot = 0; slot < message_states.size(); slot++) {
+    const auto &state = message_states[slot];
+    if (last_ts != 0 && last_seen_nanos[slot] < last_ts) {
+      continue;
     }
+
+    for (uint32_t i = 0; i < state.num_sigs; i++) {
+      const uint32_t sig = state.sig_begin + i;
+      views.push_back({
+        .address = state.address,
+        .sig_index = i,
+        .ts_nanos = last_seen_nanos[slot],
+        .value = vals[sig],
+        .all_values = &history[slot][i * history_capacity[slot]],
+        .all_values_size = history_size[slot],
+      });
+    }
+    history_size[slot] = 0;
   }
 }
+
+
+CANParserGroup::CANParserGroup(const std::vector<CANParser *> &parser_list)
+  : aligned_buf(kj::heapArray<capnp::word>(1024)), parsers(parser_list), bus_empty(parser_list.size()) {
+  for (int i = 0; i < parsers.size(); i++) {
+    const int bus = parsers[i]->bus;
+    assert(bus >= 0 && bus < 256);
+    if (bus_parsers.size() <= bus) {
+      bus_parsers.resize(bus + 1);
+    }
+    bus_parsers[bus].push_back(i);
+  }
+}
+
+#ifndef DYNAMIC_CAPNP
+void CANParserGroup::update_string(const std::string &data, bool sendcan) {
+  // format for board, make copy due to alignment issues.
+  const size_t buf_size = (data.length() / sizeof(capnp::word)) + 1;
+  if (aligned_buf.size() < buf_size) {
+    aligned_buf = kj::heapArray<capnp::word>(buf_size);
+  }
+  memcpy(aligned_buf.begin(), data.data(), data.length());
+
+  // extract the messages
+  capnp::FlatArrayMessageReader cmsg(aligned_buf.slice(0, buf_size));
+  cereal::Event::Reader event = cmsg.getRoot<cereal::Event>();
+
+  const uint64_t nanos = event.getLogMonoTime();
+  for (auto p : parsers) {
+    if (p->first_nanos == 0) {
+      p->first_nanos = nanos;
+    }
+    p->last_nanos = nanos;
+  }
+
+  // parse the messages of every bus in a single pass
+  std::fill(bus_empty.begin(), bus_empty.end(), true);
+  auto cans = sendcan ? event.getSendcan() : event.getCan();
+  for (const auto cmsg : cans) {
+    const uint8_t src = cmsg.getSrc();
+    if (src >= bus_parsers.size() || bus_parsers[src].empty()) {
+      continue;
+    }
+
+    auto dat = cmsg.getDat();
+    for (int i : bus_parsers[src]) {
+      bus_empty[i] = false;
+      if (dat.size() <= CAN_MAX_DATA_SIZE) {
+        parsers[i]->UpdateFrame(nanos, cmsg.getAddress(), dat.begin(), dat.size());
+      }
+    }
+  }
+
+  for (int i = 0; i < parsers.size(); i++) {
+    parsers[i]->update_bus_timeout(nanos, bus_empty[i]);
+    parsers[i]->UpdateValid(nanos);
+  }
+}
+
+uint64_t CANParserGroup::update_strings(const std::vector<std::string> &data, bool sendcan) {
+  uint64_t current_nanos = 0;
+  for (const auto &d : data) {
+    update_string(d, sendcan);
+    if (current_nanos == 0 && !parsers.empty()) {
+      current_nanos = parsers[0]->last_nanos;
+    }
+  }
+  return current_nanos;
+}
+#endif
@@ -6,10 +6,11 @@ from libcpp.pair cimport pair
 from libcpp.string cimport string
 from libcpp.vector cimport vector
 from libcpp.unordered_set cimport unordered_set
-from libc.stdint cimport uint32_t
+from libc.stdint cimport uint32_t, uint64_t
 
 from .common cimport CANParser as cpp_CANParser
-from .common cimport dbc_lookup, SignalValue, DBC
+from .common cimport CANParserGroup as cpp_CANParserGroup
+from .common cimport dbc_lookup, SignalValueView, DBC
 
 import numbers
 from collections import defaultdict
@@ -19,7 +20,8 @@ cdef class CANParser:
   cdef:
     cpp_CANParser *can
     const DBC *dbc
-    vector[SignalValue] can_values
+    vector[SignalValueView] can_values
+    dict sig_names
 
   cdef readonly:
     dict vl
@@ -36,6 +38,7 @@ cdef class CANParser:
     self.vl = {}
     self.vl_all = {}
     self.ts_nanos = {}
+    self.sig_names = {}
     msg_name_to_address = {}
     address_to_msg_name = {}
 
@@ -45,6 +48,7 @@ cdef class CANParser:
 
       msg_name_to_address[name] = msg.address
       address_to_msg_name[msg.address] = name
+      self.sig_names[msg.address] = [msg.sigs[j].name.decode("utf8") for j in range(msg.sigs.size())]
 
     # Convert message names into addresses and check existence in DBC
     cdef vector[pair[uint32_t, int]] message_v
@@ -71,22 +75,23 @@ cdef class CANParser:
       del self.can
 
   def update_strings(self, strings, sendcan=False):
+    self.can_values.clear()
+    self.can.update_strings(strings, self.can_values, sendcan)
+    return self.update_vl()
+
+  cdef unordered_set[uint32_t] update_vl(self):
     for v in self.vl_all.values():
       for l in v.values():  # no-cython-lint
         l.clear()
 
-    cdef vector[SignalValue] new_vals
     cdef unordered_set[uint32_t] updated_addrs
-
-    self.can.update_strings(strings, new_vals, sendcan)
-    cdef vector[SignalValue].iterator it = new_vals.begin()
-    cdef SignalValue* cv
-    while it != new_vals.end():
+    cdef vector[SignalValueView].iterator it = self.can_values.begin()
+    cdef SignalValueView* cv
+    while it != self.can_values.end():
       cv = &deref(it)
-      # Cast char * directly to unicode
-      cv_name = <unicode>cv.name
+      cv_name = self.sig_names[cv.address][cv.sig_index]
       self.vl[cv.address][cv_name] = cv.value
-      self.vl_all[cv.address][cv_name] = cv.all_values
+      self.vl_all[cv.address][cv_name] = [cv.all_values[i] for i in range(cv.all_values_size)]
       self.ts_nanos[cv.address][cv_name] = cv.ts_nanos
       updated_addrs.insert(cv.address)
       preinc(it)
@@ -102,6 +107,36 @@ cdef class CANParser:
     return self.can.bus_timeout
 
 
+cdef class CANParserGroup:
+  cdef:
+    cpp_CANParserGroup *group
+    list parsers
+
+  def __init__(self, parsers):
+    self.parsers = list(parsers)
+
+    cdef vector[cpp_CANParser *] cpp_parsers
+    cdef CANParser p
+    for p in self.parsers:
+      cpp_parsers.push_back(p.can)
+    self.group = new cpp_CANParserGroup(cpp_parsers)
+
+  def __dealloc__(self):
+    if self.group:
+      del self.group
+
+  def update_strings(self, strings, sendcan=False):
+    cdef uint64_t current_nanos = self.group.update_strings(strings, sendcan)
+
+    cdef CANParser p
+    updated_addrs = []
+    for p in self.parsers:
+      p.can_values.clear()
+      p.can.query_latest(p.can_values, current_nanos)
+      updated_addrs.append(p.update_vl())
+    return updated_addrs
+
+
 cdef class CANDefine():
   cdef:
     const DBC *dbc
@@ -0,0 +1,159 @@
+// Checks the checksum kernels in common.cc against the original bytewise and
+// bitwise implementations, and reports ns/frame for each algorithm.
+//
+// usage: benchmark_checksum [iterations]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "opendbc/can/common.h"
+
+typedef unsigned int (*checksum_func)(uint32_t address, const Signal &sig, const uint8_t *d, size_t size);
+
+// reference implementations, as they were before the table driven kernels
+
+static unsigned int ref_chrysler_checksum(uint32_t address, const Signal &sig, const uint8_t *d, size_t size) {
+  uint8_t checksum = 0xFF;
+  for (int j = 0; j < ((int)size - 1); j++) {
+    uint8_t shift = 0x80;
+    uint8_t curr = d[j];
+    for (int i = 0; i < 8; i++) {
+      uint8_t bit_sum = curr & shift;
+      uint8_t temp_chk = checksum & 0x80U;
+      if (bit_sum != 0U) {
+        bit_sum = 0x1C;
+        if (temp_chk != 0U) {
+          bit_sum = 1;
+        }
+        checksum = checksum << 1;
+        temp_chk = checksum | 1U;
+        bit_sum ^= temp_chk;
+      } else {
+        if (temp_chk != 0U) {
+          bit_sum = 0x1D;
+        }
+        checksum = checksum << 1;
+        bit_sum ^= checksum;
+      }
+      checksum = bit_sum;
+      shift = shift >> 1;
+    }
+  }
+  return ~checksum & 0xFF;
+}
+
+static unsigned int ref_pedal_checksum(uint32_t address, const Signal &sig, const uint8_t *d, size_t size) {
+  uint8_t crc = 0xFF;
+  uint8_t poly = 0xD5;
+  for (int i = (int)size - 2; i >= 0; i--) {
+    crc ^= d[i];
+    for (int j = 0; j < 8; j++) {
+      if ((crc & 0x80) != 0) {
+        crc = (uint8_t)((crc << 1) ^ poly);
+      } else {
+        crc <<= 1;
+      }
+    }
+  }
+  return crc;
+}
+
+static uint16_t ref_crc16_lut_xmodem[256];
+
+static unsigned int ref_hkg_can_fd_checksum(uint32_t address, const Signal &sig, const uint8_t *d, size_t size) {
+  uint16_t crc = 0;
+  for (size_t i = 2; i < size; i++) {
+    crc = (crc << 8) ^ ref_crc16_lut_xmodem[(crc >> 8) ^ d[i]];
+  }
+  crc = (crc << 8) ^ ref_crc16_lut_xmodem[(crc >> 8) ^ ((address >> 0) & 0xFF)];
+  crc = (crc << 8) ^ ref_crc16_lut_xmodem[(crc >> 8) ^ ((address >> 8) & 0xFF)];
+
+  if (size == 8) {
+    crc ^= 0x5f29;
+  } else if (size == 16) {
+    crc ^= 0x041d;
+  } else if (size == 24) {
+    crc ^= 0x819d;
+  } else if (size == 32) {
+    crc ^= 0x9f5b;
+  }
+  return crc;
+}
+
+struct Algorithm {
+  std::string name;
+  checksum_func func;
+  checksum_func reference;  // nullptr if only timed
+  uint32_t address;
+  std::vector<size_t> sizes;
+};
+
+int main(int argc, char *argv[]) {
+  const int iterations = argc > 1 ? std::atoi(argv[1]) : 200000;
+  init_crc_lookup_tables();
+  for (int i = 0; i < 256; i++) {
+    uint16_t crc = i << 8;
+    for (int j = 0; j < 8; j++) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+    ref_crc16_lut_xmodem[i] = crc;
+  }
+
+  const std::vector<Algorithm> algorithms = {
+    {"honda", &honda_checksum, nullptr, 0x1A6, {8}},
+    {"toyota", &toyota_checksum, nullptr, 0x2E4, {8}},
+    {"subaru", &subaru_checksum, nullptr, 0x122, {8}},
+    {"chrysler", &chrysler_checksum, &ref_chrysler_checksum, 0x292, {8}},
+    {"volkswagen_mqb", &volkswagen_mqb_checksum, nullptr, 0x126, {8}},
+    {"xor", &xor_checksum, nullptr, 0x5E0, {8}},
+    {"pedal", &pedal_checksum, &ref_pedal_checksum, 0x200, {6}},
+    {"hkg_can_fd", &hkg_can_fd_checksum, &ref_hkg_can_fd_checksum, 0x50, {8, 16, 24, 32, 64}},
+  };
+
+  Signal sig = {};
+  sig.start_bit = 0;
+
+  std::mt19937 rng(0);
+  bool ok = true;
+  for (const auto &alg : algorithms) {
+    for (size_t size : alg.sizes) {
+      std::vector<std::vector<uint8_t>> frames(256, std::vector<uint8_t>(size));
+      for (auto &f : frames) {
+        for (auto &b : f) b = rng();
+      }
+
+      if (alg.reference) {
+        for (const auto &f : frames) {
+          if (alg.func(alg.address, sig, f.data(), size) != alg.reference(alg.address, sig, f.data(), size)) {
+            fprintf(stderr, "%s: mismatch for %zu byte frame\n", alg.name.c_str(), size);
+            ok = false;
+            break;
+          }
+        }
+      }
+
+      auto time_frames = [&](checksum_func func) {
+        unsigned int sink = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+          const auto &f = frames[i & 0xFF];
+          sink += func(alg.address, sig, f.data(), size);
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        if (sink == 1) printf(" ");  // keep the calls from being optimized out
+        return ns / iterations;
+      };
+
+      printf("%-16s %2zu bytes: %7.2f ns/frame", alg.name.c_str(), size, time_frames(alg.func));
+      if (alg.reference) {
+        printf(" (reference %7.2f ns/frame)", time_frames(alg.reference));
+      }
+      printf("\n");
+    }
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,177 @@
+// Measures DBC load time for every DBC in opendbc: the std::regex parser the tokenizer replaced,
+// the tokenizer, and loading the binary cache. Exits with an error if the regex and tokenizer
+// parsers disagree on any DBC.
+//
+// usage: benchmark_dbc [iterations]
+
+#include <algorithm>
+#include <chrono>
+#include <clocale>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "opendbc/can/common.h"
+
+// the regex based parser, as it was before the tokenizer. Only parses, without the duplicate
+// checks and checksum types of dbc_parse_from_stream
+static const std::regex bo_regexp(R"(^BO_ (\w+) (\w+) *: (\w+) (\w+))");
+static const std::regex sg_regexp(R"(^SG_ (\w+) : (\d+)\|(\d+)@(\d+)([\+|\-]) \(([0-9.+\-eE]+),([0-9.+\-eE]+)\) \[([0-9.+\-eE]+)\|([0-9.+\-eE]+)\] \"(.*)\" (.*))");
+static const std::regex sgm_regexp(R"(^SG_ (\w+) (\w+) *: (\d+)\|(\d+)@(\d+)([\+|\-]) \(([0-9.+\-eE]+),([0-9.+\-eE]+)\) \[([0-9.+\-eE]+)\|([0-9.+\-eE]+)\] \"(.*)\" (.*))");
+static const std::regex val_regexp(R"(VAL_ (\w+) (\w+) (\s*[-+]?[0-9]+\s+\".+?\"[^;]*))");
+static const std::regex val_split_regexp{R"([\"]+)"};  // split on "
+
+static std::string &trim(std::string &s, const char *t = " \t\n\r\f\v") {
+  s.erase(s.find_last_not_of(t) + 1);
+  return s.erase(0, s.find_first_not_of(t));
+}
+
+static DBC *regex_parse(const std::string &dbc_name, std::istream &stream) {
+  uint32_t address = 0;
+  std::map<uint32_t, std::vector<Signal>> signals;
+  DBC *dbc = new DBC;
+  dbc->name = dbc_name;
+  std::setlocale(LC_NUMERIC, "C");
+
+  std::vector<int> be_bits;
+  for (int i = 0; i < 64; i++) {
+    for (int j = 7; j >= 0; j--) {
+      be_bits.push_back(j + i * 8);
+    }
+  }
+
+  std::string line;
+  std::smatch match;
+  while (std::getline(stream, line)) {
+    line = trim(line);
+    if (line.rfind("BO_ ", 0) == 0) {
+      if (!std::regex_match(line, match, bo_regexp)) throw std::runtime_error("bad BO: " + line);
+
+      Msg &msg = dbc->msgs.emplace_back();
+      address = msg.address = std::stoul(match[1].str());
+      msg.name = match[2].str();
+      msg.size = std::stoul(match[3].str());
+    } else if (line.rfind("SG_ ", 0) == 0) {
+      int offset = 0;
+      if (!std::regex_search(line, match, sg_regexp)) {
+        if (!std::regex_search(line, match, sgm_regexp)) throw std::runtime_error("bad SG: " + line);
+        offset = 1;
+      }
+      Signal &sig = signals[address].emplace_back();
+      sig.name = match[1].str();
+      sig.start_bit = std::stoi(match[offset + 2].str());
+      sig.size = std::stoi(match[offset + 3].str());
+      sig.is_little_endian = std::stoi(match[offset + 4].str()) == 1;
+      sig.is_signed = match[offset + 5].str() == "-";
+      sig.factor = std::stod(match[offset + 6].str());
+      sig.offset = std::stod(match[offset + 7].str());
+      if (sig.is_little_endian) {
+        sig.lsb = sig.start_bit;
+        sig.msb = sig.start_bit + sig.size - 1;
+      } else {
+        auto it = std::find(be_bits.begin(), be_bits.end(), sig.start_bit);
+        sig.lsb = be_bits[(it - be_bits.begin()) + sig.size - 1];
+        sig.msb = sig.start_bit;
+      }
+    } else if (line.rfind("VAL_ ", 0) == 0) {
+      if (!std::regex_search(line, match, val_regexp)) throw std::runtime_error("bad VAL: " + line);
+
+      auto &val = dbc->vals.emplace_back();
+      val.address = std::stoul(match[1].str());
+      val.name = match[2].str();
+
+      auto defvals = match[3].str();
+      std::sregex_token_iterator it{defvals.begin(), defvals.end(), val_split_regexp, -1};
+      std::vector<std::string> words{it, {}};
+      for (auto &w : words) {
+        w = trim(w);
+        std::transform(w.begin(), w.end(), w.begin(), ::toupper);
+        std::replace(w.begin(), w.end(), ' ', '_');
+      }
+      std::stringstream s;
+      std::copy(words.begin(), words.end(), std::ostream_iterator<std::string>(s, " "));
+      val.def_val = s.str();
+      val.def_val = trim(val.def_val);
+    }
+  }
+
+  for (auto &m : dbc->msgs) {
+    m.sigs = signals[m.address];
+  }
+  for (auto &v : dbc->vals) {
+    v.sigs = signals[v.address];
+  }
+  return dbc;
+}
+
+static bool same_signals(const std::vector<Signal> &a, const std::vector<Signal> &b) {
+  return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const Signal &x, const Signal &y) {
+    return x.name == y.name && x.start_bit == y.start_bit && x.size == y.size && x.msb == y.msb && x.lsb == y.lsb &&
+           x.is_signed == y.is_signed && x.is_little_endian == y.is_little_endian && x.factor == y.factor && x.offset == y.offset;
+  });
+}
+
+static bool same_dbc(const DBC &a, const DBC &b) {
+  return std::equal(a.msgs.begin(), a.msgs.end(), b.msgs.begin(), b.msgs.end(), [](const Msg &x, const Msg &y) {
+           return x.name == y.name && x.address == y.address && x.size == y.size && same_signals(x.sigs, y.sigs);
+         }) &&
+         std::equal(a.vals.begin(), a.vals.end(), b.vals.begin(), b.vals.end(), [](const Val &x, const Val &y) {
+           return x.name == y.name && x.address == y.address && x.def_val == y.def_val;
+         });
+}
+
+template <typename F>
+static double time_us(int iterations, F fn) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) fn();
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / iterations;
+}
+
+int main(int argc, char *argv[]) {
+  const int iterations = argc > 1 ? std::atoi(argv[1]) : 10;
+  if (!std::getenv("DBC_CACHE_DIR")) {
+    setenv("DBC_CACHE_DIR", "/tmp/opendbc_cache_benchmark", 1);
+  }
+
+  bool ok = true;
+  double total_regex = 0, total_parse = 0, total_cached = 0;
+  for (const auto &name : get_dbc_names()) {
+    const std::string path = std::string(DBC_FILE_PATH) + "/" + name + ".dbc";
+
+    double regex = time_us(iterations, [&]() {
+      std::ifstream infile(path);
+      std::unique_ptr<DBC> dbc(regex_parse(name, infile));
+    });
+    double parse = time_us(iterations, [&]() {
+      std::unique_ptr<DBC> dbc(dbc_parse(path, false));
+    });
+    std::unique_ptr<DBC> warm(dbc_parse(path, true));  // write the cache
+    double cached = time_us(iterations, [&]() {
+      std::unique_ptr<DBC> dbc(dbc_parse(path, true));
+    });
+
+    std::ifstream infile(path);
+    std::unique_ptr<DBC> baseline(regex_parse(name, infile));
+    std::unique_ptr<DBC> parsed(dbc_parse(path, false));
+    if (!same_dbc(*baseline, *parsed)) {
+      printf("MISMATCH %s: the tokenizer and regex parsers disagree\n", name.c_str());
+      ok = false;
+    }
+
+    printf("%-55s %4zu msgs  regex %9.1f us  parse %9.1f us  cached %8.1f us\n", name.c_str(), warm->msgs.size(), regex, parse, cached);
+    total_regex += regex;
+    total_parse += parse;
+    total_cached += cached;
+  }
+  printf("total: regex %.2f ms, parse %.2f ms (%.1fx), cached %.2f ms (%.1fx)\n", total_regex / 1000,
+         total_parse / 1000, total_regex / total_parse, total_cached / 1000, total_regex / total_cached);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+// Checks that CANPacker::pack_prepared writes the same bytes as pack for every
+// message of DBCs with each checksum type: auto incremented and explicit
+// COUNTER, CHECKSUM and unknown signal names. Reports ns/message for both.
+//
+// usage: benchmark_packer [iterations]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "opendbc/can/common.h"
+
+static const char *DBCS[] = {
+  "honda_civic_touring_2016_can_generated",
+  "toyota_nodsu_pt_generated",
+  "hyundai_canfd",
+  "vw_mqb_2010",
+  "vw_golf_mk4",
+  "subaru_global_2017_generated",
+  "chrysler_pacifica_2017_hybrid_generated",
+  "comma_body",
+  "hyundai_kia_generic",
+};
+
+struct Case {
+  uint32_t address;
+  std::vector<std::string> names;
+  std::vector<const Signal *> sigs;  // nullptr for unknown names
+};
+
+// a random value that packs without overflow
+static double random_value(std::mt19937 &rng, const Signal &sig) {
+  int bits = std::min<int>(sig.size, 32);
+  int64_t raw = rng() & ((1ULL << bits) - 1);
+  if (sig.is_signed && (raw >> (bits - 1))) raw -= 1LL << bits;
+  return raw * sig.factor + sig.offset;
+}
+
+static bool check(CANPacker &packer, CANPacker &prepared_packer, int handle, const Case &c,
+                  const std::vector<double> &values, const char *dbc_name, const char *what) {
+  std::vector<SignalPackValue> signals;
+  for (int i = 0; i < c.names.size(); i++) {
+    signals.push_back({c.names[i], values[i]});
+  }
+  std::vector<uint8_t> expected = packer.pack(c.address, signals);
+
+  uint8_t out[CAN_PADDED_DATA_SIZE] = {};
+  size_t size = prepared_packer.pack_prepared(handle, values.data(), out);
+  if (size != expected.size() || memcmp(out, expected.data(), size) != 0) {
+    printf("MISMATCH %s 0x%X (%s)\n", dbc_name, c.address, what);
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  const int iterations = argc > 1 ? atoi(argv[1]) : 1000;
+  std::mt19937 rng(0);
+  bool ok = true;
+  double pack_ns = 0, prepared_ns = 0;
+  size_t packed = 0;
+
+  for (const char *dbc_name : DBCS) {
+    const DBC *dbc = dbc_lookup(dbc_name);
+    if (!dbc) {
+      printf("missing %s\n", dbc_name);
+      return 1;
+    }
+    CANPacker packer(dbc_name), prepared_packer(dbc_name);
+    bool checked_unknown = false;
+
+    for (const Msg &msg : dbc->msgs) {
+      const Signal *counter = nullptr;
+      bool unknown = false;
+      Case auto_counter = {msg.address}, explicit_counter = {msg.address};
+      for (const Signal &sig : msg.sigs) {
+        if (sig.name == "COUNTER") {
+          counter = &sig;
+          continue;
+        }
+        auto_counter.names.push_back(sig.name);
+        auto_counter.sigs.push_back(&sig);
+      }
+      // COUNTER first, so signals set after it don't change the counter
+      if (counter) {
+        explicit_counter.names.push_back(counter->name);
+        explicit_counter.sigs.push_back(counter);
+      }
+      explicit_counter.names.insert(explicit_counter.names.end(), auto_counter.names.begin(), auto_counter.names.end());
+      explicit_counter.sigs.insert(explicit_counter.sigs.end(), auto_counter.sigs.begin(), auto_counter.sigs.end());
+
+      // pack warns about unknown signals on every call, only check them once per DBC
+      if (!checked_unknown && counter) {
+        auto_counter.names.insert(auto_counter.names.begin() + auto_counter.names.size() / 2, "NOT_A_SIGNAL");
+        auto_counter.sigs.insert(auto_counter.sigs.begin() + auto_counter.sigs.size() / 2, nullptr);
+        checked_unknown = unknown = true;
+      }
+
+      int auto_handle = prepared_packer.prepare_message(msg.address, auto_counter.names);
+      int explicit_handle = prepared_packer.prepare_message(msg.address, explicit_counter.names);
+
+      // auto incremented past a wrap, then set explicitly, then incremented from the set value
+      for (int round = 0; round < 3 && ok; round++) {
+        const Case &c = round == 1 ? explicit_counter : auto_counter;
+        const int handle = round == 1 ? explicit_handle : auto_handle;
+        const int packs = unknown ? 1 : (counter ? (1 << std::min<int>(counter->size, 4)) + 1 : 2);
+        for (int i = 0; i < packs && ok; i++) {
+          std::vector<double> values;
+          for (const Signal *sig : c.sigs) {
+            values.push_back(sig ? random_value(rng, *sig) : 1.0);
+          }
+          ok = check(packer, prepared_packer, handle, c, values, dbc_name, round == 1 ? "explicit COUNTER" : "auto COUNTER");
+        }
+      }
+      if (!ok) return 1;
+      if (unknown) continue;
+
+      std::vector<SignalPackValue> signals;
+      std::vector<double> values;
+      for (const Signal *sig : auto_counter.sigs) {
+        values.push_back(random_value(rng, *sig));
+        signals.push_back({sig->name, values.back()});
+      }
+      uint8_t out[CAN_PADDED_DATA_SIZE];
+
+      auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < iterations; i++) {
+        packer.pack(msg.address, signals);
+      }
+      auto mid = std::chrono::steady_clock::now();
+      for (int i = 0; i < iterations; i++) {
+        prepared_packer.pack_prepared(auto_handle, values.data(), out);
+      }
+      auto end = std::chrono::steady_clock::now();
+      pack_ns += std::chrono::duration<double, std::nano>(mid - start).count();
+      prepared_ns += std::chrono::duration<double, std::nano>(end - mid).count();
+      packed += iterations;
+    }
+  }
+
+  printf("pack_prepared matches pack for %zu DBCs\n", std::size(DBCS));
+  printf("%-14s %8.1f ns/message\n", "pack", pack_ns / packed);
+  printf("%-14s %8.1f ns/message\n", "pack_prepared", prepared_ns / packed);
+  return 0;
+}
@@ -0,0 +1,133 @@
+// Compares the legacy per-frame decoding path (unordered_map lookup, a vector
+// copy per frame, a byte walk per signal and owning query results) against
+// CANParser::UpdateFrame and the view based query_latest.
+//
+// usage: benchmark_parser [dbc_name] [iterations]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "opendbc/can/common.h"
+
+struct LegacyState {
+  std::vector<Signal> parse_sigs;
+  std::vector<double> vals;
+  std::vector<std::vector<double>> all_vals;
+};
+
+struct Frame {
+  uint32_t address;
+  std::vector<uint8_t> dat;
+};
+
+static void legacy_parse(std::unordered_map<uint32_t, LegacyState> &states, const Frame &frame) {
+  auto state_it = states.find(frame.address);
+  if (state_it == states.end()) return;
+  LegacyState &state = state_it->second;
+
+  std::vector<uint8_t> dat(frame.dat.size(), 0);
+  memcpy(dat.data(), frame.dat.data(), frame.dat.size());
+
+  std::vector<double> tmp_vals(state.parse_sigs.size());
+  for (int i = 0; i < state.parse_sigs.size(); i++) {
+    const auto &sig = state.parse_sigs[i];
+    int64_t tmp = get_raw_value(dat, sig);
+    if (sig.is_signed) {
+      tmp -= ((tmp >> (sig.size-1)) & 0x1) ? (1ULL << sig.size) : 0;
+    }
+    tmp_vals[i] = tmp * sig.factor + sig.offset;
+  }
+  for (int i = 0; i < state.parse_sigs.size(); i++) {
+    state.vals[i] = tmp_vals[i];
+    state.all_vals[i].push_back(state.vals[i]);
+  }
+}
+
+static void legacy_query(std::unordered_map<uint32_t, LegacyState> &states, std::vector<SignalValue> &vals) {
+  for (auto &[address, state] : states) {
+    for (int i = 0; i < state.parse_sigs.size(); i++) {
+      SignalValue &v = vals.emplace_back();
+      v.address = address;
+      v.name = state.parse_sigs[i].name;
+      v.value = state.vals[i];
+      v.all_values = state.all_vals[i];
+      state.all_vals[i].clear();
+    }
+  }
+}
+
+template <typename F>
+static double time_ns(int iterations, F fn) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) fn();
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[]) {
+  const std::string dbc_name = argc > 1 ? argv[1] : "hyundai_canfd";
+  const int iterations = argc > 2 ? std::atoi(argv[2]) : 2000;
+
+  const DBC *dbc = dbc_lookup(dbc_name);
+  if (!dbc) {
+    fprintf(stderr, "can't find DBC: %s\n", dbc_name.c_str());
+    return 1;
+  }
+
+  CANParser parser(0, dbc_name, true, true);
+  std::unordered_map<uint32_t, LegacyState> legacy_states;
+  std::vector<Frame> frames;
+  std::mt19937 rng(0);
+  size_t num_signals = 0;
+  for (const auto &msg : dbc->msgs) {
+    LegacyState &state = legacy_states[msg.address];
+    state.parse_sigs = msg.sigs;
+    state.vals.resize(msg.sigs.size());
+    state.all_vals.resize(msg.sigs.size());
+    num_signals += msg.sigs.size();
+
+    auto &f = frames.emplace_back(Frame{msg.address, std::vector<uint8_t>(msg.size)});
+    for (auto &b : f.dat) b = rng();
+  }
+  std::shuffle(frames.begin(), frames.end(), rng);
+
+  // both paths must decode every signal identically
+  std::vector<SignalValue> values;
+  for (const auto &f : frames) {
+    legacy_parse(legacy_states, f);
+    parser.UpdateFrame(1, f.address, f.dat.data(), f.dat.size());
+  }
+  parser.query_latest(values, 1);
+  for (const auto &v : values) {
+    const LegacyState &state = legacy_states[v.address];
+    for (int i = 0; i < state.parse_sigs.size(); i++) {
+      if (state.parse_sigs[i].name == v.name && state.vals[i] != v.value) {
+        fprintf(stderr, "mismatch decoding 0x%X %s\n", v.address, v.name.c_str());
+        return 1;
+      }
+    }
+  }
+
+  const double num_frames = (double)frames.size() * iterations;
+  double legacy = time_ns(iterations, [&]() {
+    for (const auto &f : frames) legacy_parse(legacy_states, f);
+    values.clear();
+    legacy_query(legacy_states, values);
+  });
+  std::vector<SignalValueView> views;
+  double compiled = time_ns(iterations, [&]() {
+    for (const auto &f : frames) parser.UpdateFrame(1, f.address, f.dat.data(), f.dat.size());
+    views.clear();
+    parser.query_latest(views, 1);
+  });
+
+  printf("%s: %zu messages, %zu signals, %d iterations\n", dbc_name.c_str(), frames.size(), num_signals, iterations);
+  printf("legacy:   %8.1f ns/frame\n", legacy / num_frames);
+  printf("compiled: %8.1f ns/frame (%.2fx)\n", compiled / num_frames, legacy / compiled);
+  return 0;
+}
@@ -39,6 +39,12 @@ EKFSym::EKFSym(std::string name, Map<MatrixXdr> Q, Map<VectorXd> x_initial, Map<
   this->Q = Q;
 
   this->max_rewind_age = max_rewind_age;
+  this->rewind_slots.resize(REWIND_TO_KEEP);
+  for (RewindSlot &slot : this->rewind_slots) {
+    slot.x.resize(this->dim_x);
+    slot.P.resize(this->dim_err, this->dim_err);
+  }
+  this->rewound.resize(REWIND_TO_KEEP);
   this->init_state(x_initial, P_initial, NAN);
 }
 
@@ -84,113 +90,135 @@ std::optional<Estimate> EKFSym::predict_and_update_batch(double t, int kind, std
     std::vector<Map<MatrixXdr>> R_map, std::vector<std::vector<double>> extra_args, bool augment)
 {
   // TODO handle rewinding at this level
+  assert(z_map.size() == R_map.size());
+  assert(z_map.size() == extra_args.size());
+  assert(!augment); // TODO
 
-  std::deque<Observation> rewound;
+  size_t n_rewound = 0;
   if (!std::isnan(this->filter_time) && t < this->filter_time) {
-    if (this->rewind_t.empty() || t < this->rewind_t.front() || t < this->rewind_t.back() - this->max_rewind_age) {
+    if (this->rewind_count == 0 || t < this->rewind_slot(0).t || t < this->rewind_slot(this->rewind_count - 1).t - this->max_rewind_age) {
       LOGD("observation too old at %f with filter at %f, ignoring!", t, this->filter_time);
       return std::nullopt;
     }
-    rewound = this->rewind(t);
+    n_rewound = this->rewind(t);
   }
 
-  Observation obs;
+  // the observation is stored straight into the checkpoint it ends up in
+  RewindSlot &obs = this->next_checkpoint();
   obs.t = t;
   obs.kind = kind;
-  obs.extra_args = extra_args;
-  for (Map<VectorXd> zi : z_map) {
-    obs.z.push_back(zi);
-  }
-  for (Map<MatrixXdr> Ri : R_map) {
-    obs.R.push_back(Ri);
+  obs.z_rows.clear();
+  obs.extra_args_size.clear();
+  obs.data.clear();
+  for (int i = 0; i < z_map.size(); i++) {
+    assert(z_map[i].rows() == R_map[i].rows());
+    assert(z_map[i].rows() == R_map[i].cols());
+    obs.z_rows.push_back(z_map[i].rows());
+    obs.extra_args_size.push_back(extra_args[i].size());
+    obs.data.insert(obs.data.end(), z_map[i].data(), z_map[i].data() + z_map[i].size());
+    obs.data.insert(obs.data.end(), R_map[i].data(), R_map[i].data() + R_map[i].size());
+    obs.data.insert(obs.data.end(), extra_args[i].begin(), extra_args[i].end());
   }
 
-  std::optional<Estimate> res = std::make_optional(this->predict_and_update_batch(obs, augment));
+  Estimate res;
+  this->predict_and_update_batch(obs, &res);
 
   // optional fast forward
-  while (!rewound.empty()) {
-    this->predict_and_update_batch(rewound.front(), false);
-    rewound.pop_front();
+  while (n_rewound > 0) {
+    RewindSlot &next = this->next_checkpoint();
+    std::swap(next, this->rewound[--n_rewound]);
+    this->predict_and_update_batch(next, nullptr);
   }
 
   return res;
 }
 
 void EKFSym::reset_rewind() {
-  this->rewind_obscache.clear();
-  this->rewind_t.clear();
-  this->rewind_states.clear();
+  this->rewind_head = 0;
+  this->rewind_count = 0;
 }
 
-std::deque<Observation> EKFSym::rewind(double t) {
-  std::deque<Observation> rewound;
-
-  // rewind observations until t is after previous observation
-  while (this->rewind_t.back() > t) {
-    rewound.push_front(this->rewind_obscache.back());
-    this->rewind_t.pop_back();
-    this->rewind_states.pop_back();
-    this->rewind_obscache.pop_back();
-  }
-
-  // set the state to the time right before that
-  this->filter_time = this->rewind_t.back();
-  this->x = this->rewind_states.back().first;
-  this->P = this->rewind_states.back().second;
+EKFSym::RewindSlot &EKFSym::rewind_slot(size_t i) {
+  return this->rewind_slots[(this->rewind_head + i) % REWIND_TO_KEEP];
+}
 
-  return rewound;
+EKFSym::RewindSlot &EKFSym::next_checkpoint() {
+  // when the ring is full this is the oldest checkpoint, which gets dropped
+  return this->rewind_slot(this->rewind_count);
 }
 
-void EKFSym::checkpoint(Observation& obs) {
-  // push to rewinder
-  this->rewind_t.push_back(this->filter_time);
-  this->rewind_states.push_back(std::make_pair(this->x, this->P));
-  this->rewind_obscache.push_back(obs);
+size_t EKFSym::rewind(double t) {
+  size_t n_rewound = 0;
 
-  // only keep a certain number around
-  if (this->rewind_t.size() > REWIND_TO_KEEP) {
-    this->rewind_t.pop_front();
-    this->rewind_states.pop_front();
-    this->rewind_obscache.pop_front();
+  // rewind observations until t is after previous observation. The slots are swapped out,
+  // so replaying them doesn't overwrite the ones not yet replayed
+  while (this->rewind_slot(this->rewind_count - 1).t > t) {
+    std::swap(this->rewind_slot(this->rewind_count - 1), this->rewound[n_rewound++]);
+    this->rewind_count--;
   }
-}
 
-Estimate EKFSym::predict_and_update_batch(Observation& obs, bool augment) {
-  assert(obs.z.size() == obs.R.size());
-  assert(obs.z.size() == obs.extra_args.size());
+  // set the state to the time right before that
+  const RewindSlot &last = this->rewind_slot(this->rewind_count - 1);
+  this->filter_time = last.t;
+  this->x = last.x;
+  this->P = last.P;
+
+  return n_rewound;
+}
+
+void EKFSym::checkpoint(RewindSlot& obs) {
+  // push to rewinder, only keep a certain number around
+  obs.t = this->filter_time;
+  obs.x = this->x;
+  obs.P = this->P;
+  if (this->rewind_count == REWIND_TO_KEEP) {
+    this->rewind_head = (this->rewind_head + 1) % REWIND_TO_KEEP;
+  } else {
+    this->rewind_count++;
+  }
+}
 
+void EKFSym::predict_and_update_batch(RewindSlot& obs, Estimate *res) {
   this->predict(obs.t);
 
-  Estimate res;
-  res.t = obs.t;
-  res.kind = obs.kind;
-  res.z = obs.z;
-  res.extra_args = obs.extra_args;
-  res.xk1 = this->x;
-  res.Pk1 = this->P;
+  if (res) {
+    res->t = obs.t;
+    res->kind = obs.kind;
+    res->xk1 = this->x;
+    res->Pk1 = this->P;
+  }
 
   // update batch
-  std::vector<VectorXd> y;
-  for (int i = 0; i < obs.z.size(); i++) {
-    assert(obs.z[i].rows() == obs.R[i].rows());
-    assert(obs.z[i].rows() == obs.R[i].cols());
-
-    // update state
-    y.push_back(this->update(obs.kind, obs.z[i], obs.R[i], obs.extra_args[i]));
+  double *dat = obs.data.data();
+  for (int i = 0; i < obs.z_rows.size(); i++) {
+    int z_rows = obs.z_rows[i];
+    double *z = dat;
+    double *R = z + z_rows;
+    double *extra_args = R + z_rows * z_rows;
+    dat = extra_args + obs.extra_args_size[i];
+
+    // update state, the generated update writes the residual over z so it gets a copy
+    this->update_z.assign(z, z + z_rows);
+    this->ekf->updates.at(obs.kind)(this->x.data(), this->P.data(), this->update_z.data(), R, extra_args);
+    this->normalize_quaternions();
+
+    if (res) {
+      int y_rows = z_rows;
+      if (this->msckf && std::find(this->feature_track_kinds.begin(), this->feature_track_kinds.end(), obs.kind) != this->feature_track_kinds.end()) {
+        y_rows -= obs.extra_args_size[i];
+      }
+      res->z.push_back(Map<VectorXd>(z, z_rows));
+      res->y.push_back(Map<VectorXd>(this->update_z.data(), y_rows));
+      res->extra_args.emplace_back(extra_args, extra_args + obs.extra_args_size[i]);
+    }
   }
 
-  res.xk = this->x;
-  res.Pk = this->P;
-  res.y = y;
-
-  assert(!augment); // TODO
-  // if (augment) {
-  //   this->augment();
-  // }
+  if (res) {
+    res->xk = this->x;
+    res->Pk = this->P;
+  }
 
   this->checkpoint(obs);
-
-  return res;
 }
 
 void EKFSym::predict(double t) {
@@ -208,16 +236,6 @@ void EKFSym::predict(double t) {
   this->filter_time = t;
 }
 
-VectorXd EKFSym::update(int kind, VectorXd z, MatrixXdr R, std::vector<double> extra_args) {
-  this->ekf->updates.at(kind)(this->x.data(), this->P.data(), z.data(), R.data(), extra_args.data());
-  this->normalize_quaternions();
-
-  if (this->msckf && std::find(this->feature_track_kinds.begin(), this->feature_track_kinds.end(), kind) != this->feature_track_kinds.end()) {
-    return z.head(z.rows() - extra_args.size());
-  }
-  return z;
-}
-
 extra_routine_t EKFSym::get_extra_routine(const std::string& routine) {
   return this->ekf->extra_routines.at(routine);
 }
@@ -4,7 +4,6 @@
 #include <cassert>
 #include <string>
 #include <vector>
-#include <deque>
 #include <unordered_map>
 #include <map>
 #include <cmath>
@@ -21,14 +20,6 @@ namespace EKFS {
 
 typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> MatrixXdr;
 
-typedef struct Observation {
-  double t;
-  int kind;
-  std::vector<Eigen::VectorXd> z;
-  std::vector<MatrixXdr> R;
-  std::vector<std::vector<double>> extra_args;
-} Observation;
-
 typedef struct Estimate {
   Eigen::VectorXd xk1;
   Eigen::VectorXd xk;
@@ -66,11 +57,24 @@ public:
   extra_routine_t get_extra_routine(const std::string& routine);
 
 private:
-  std::deque<Observation> rewind(double t);
-  void checkpoint(Observation& obs);
-
-  Estimate predict_and_update_batch(Observation& obs, bool augment);
-  Eigen::VectorXd update(int kind, Eigen::VectorXd z, MatrixXdr R, std::vector<double> extra_args);
+  // An observation batch and the filter state right after it. The rewind ring is allocated at
+  // construction and the buffers of its slots are reused, so checkpoints don't allocate
+  struct RewindSlot {
+    double t;
+    int kind;
+    std::vector<int> z_rows;  // observation i has z_rows[i] values and a z_rows[i] x z_rows[i] R
+    std::vector<int> extra_args_size;
+    std::vector<double> data;  // z, R and extra_args of every observation, back to back
+    Eigen::VectorXd x;
+    MatrixXdr P;
+  };
+
+  size_t rewind(double t);
+  RewindSlot &rewind_slot(size_t i);
+  RewindSlot &next_checkpoint();
+  void checkpoint(RewindSlot& obs);
+
+  void predict_and_update_batch(RewindSlot& obs, Estimate *res);
 
   // stuct with linked sympy generated functions
   const EKF *ekf = NULL;
@@ -101,9 +105,11 @@ private:
 
   // rewind stuff
   double max_rewind_age;
-  std::deque<double> rewind_t;
-  std::deque<std::pair<Eigen::VectorXd, MatrixXdr>> rewind_states;
-  std::deque<Observation> rewind_obscache;
+  std::vector<RewindSlot> rewind_slots;  // ring of REWIND_TO_KEEP checkpoints
+  size_t rewind_head = 0;  // oldest checkpoint
+  size_t rewind_count = 0;
+  std::vector<RewindSlot> rewound;  // checkpoints taken back by a rewind, newest first
+  std::vector<double> update_z;
 
   Eigen::VectorXd augment_times;
 
@@ -7,6 +7,7 @@
 #include <cassert>
 #include <cerrno>
 #include <chrono>
+#include <cstring>
 #include <future>
 #include <memory>
 #include <thread>
@@ -234,35 +235,107 @@ void can_send_thread(std::vector<Panda *> pandas, bool fake_send) {
   }
 }
 
+// Frames per published batch and the interval between the reads that returned frames, logged every 10s.
+// A frame may have reached the panda right after the previous read, so the interval bounds its age.
+struct CanRecvStats {
+  void update(size_t frames, uint64_t read_interval) {
+    ++batches;
+    total_frames += frames;
+    max_frames = std::max(max_frames, frames);
+    if (frames > 0) {
+      total_interval += read_interval;
+      max_interval = std::max(max_interval, read_interval);
+      ++batches_with_frames;
+    }
+
+    const uint64_t ts = nanos_since_boot();
+    if (ts - log_ts >= 10e9) {
+      if (log_ts > 0 && batches > 0) {
+        LOGD("can recv: %zu batches, %.1f frames/batch (max %zu), read interval %.2f ms (max %.2f ms)",
+             batches, total_frames / (double)batches, max_frames,
+             batches_with_frames ? total_interval / 1e6 / batches_with_frames : 0.0, max_interval / 1e6);
+      }
+      *this = {};
+      log_ts = ts;
+    }
+  }
+
+  uint64_t log_ts = 0;
+  size_t batches = 0, batches_with_frames = 0, total_frames = 0, max_frames = 0;
+  uint64_t total_interval = 0, max_interval = 0;
+};
+
 void can_recv_thread(std::vector<Panda *> pandas) {
   util::set_thread_name("boardd_can_recv");
 
   PubMaster pm({"can"});
 
-  // run at 100Hz
+  // run at 100Hz, or with BOARDD_ADAPTIVE_CAN_RECV read again CAN_RECV_MIN_INTERVAL after frames
+  // were received, backing off to CAN_RECV_MAX_DELAY while the buses are idle. A full receive
+  // buffer is read again right away.
+  const bool adaptive = getenv("BOARDD_ADAPTIVE_CAN_RECV") != nullptr;
+  const uint64_t CAN_RECV_MIN_INTERVAL = 1e6;
+  const uint64_t CAN_RECV_MAX_DELAY = 10e6;
   RateKeeper rk("boardd_can_recv", 100);
-  std::vector<can_frame> raw_can_data;
+  uint64_t interval = CAN_RECV_MAX_DELAY;
+  uint64_t prev_read_ts = nanos_since_boot();
+  CanRecvStats stats;
+
+  // buffers reused every cycle: the received frames, the first segment of the message and
+  // the serialized message. The segment grows to the size of the largest message so far.
+  std::vector<can_recv_frame> raw_can_data;
+  raw_can_data.reserve(pandas.size() * CAN_RECV_FRAMES_MAX);
+  kj::Array<capnp::word> segment, serialized = kj::heapArray<capnp::word>(1024);
 
   while (!do_exit && check_all_connected(pandas)) {
     bool comms_healthy = true;
+    bool receive_full = false;
     raw_can_data.clear();
     for (const auto& panda : pandas) {
       comms_healthy &= panda->can_receive(raw_can_data);
+      receive_full |= panda->can_receive_full();
+    }
+    const uint64_t read_ts = nanos_since_boot();
+    stats.update(raw_can_data.size(), read_ts - prev_read_ts);
+    prev_read_ts = read_ts;
+
+    if (segment.size() < serialized.size()) {
+      segment = kj::heapArray<capnp::word>(serialized.size());
+      memset(segment.begin(), 0, segment.asBytes().size());
+    }
+
+    size_t msg_size = 0;
+    {
+      MessageBuilder msg(segment);
+      auto evt = msg.initEvent();
+      evt.setValid(comms_healthy);
+      auto canData = evt.initCan(raw_can_data.size());
+      for (uint i = 0; i<raw_can_data.size(); i++) {
+        canData[i].setAddress(raw_can_data[i].address);
+        canData[i].setBusTime(0);
+        canData[i].setDat(kj::arrayPtr(raw_can_data[i].dat, raw_can_data[i].len));
+        canData[i].setSrc(raw_can_data[i].src);
+      }
+
+      msg_size = msg.getSerializedSize();
+      if (msg_size > serialized.asBytes().size()) {
+        serialized = kj::heapArray<capnp::word>(msg_size / sizeof(capnp::word));
+      }
+      msg.serializeToBuffer(serialized.asBytes().begin(), msg_size);
     }
+    pm.send("can", serialized.asBytes().begin(), msg_size);
 
-    MessageBuilder msg;
-    auto evt = msg.initEvent();
-    evt.setValid(comms_healthy);
-    auto canData = evt.initCan(raw_can_data.size());
-    for (uint i = 0; i<raw_can_data.size(); i++) {
-      canData[i].setAddress(raw_can_data[i].address);
-      canData[i].setBusTime(raw_can_data[i].busTime);
-      canData[i].setDat(kj::arrayPtr((uint8_t*)raw_can_data[i].dat.data(), raw_can_data[i].dat.size()));
-      canData[i].setSrc(raw_can_data[i].src);
+    if (!adaptive) {
+      rk.keepTime();
+      continue;
     }
-    pm.send("can", msg);
+    if (receive_full) continue;
 
-    rk.keepTime();
+    interval = raw_can_data.empty() ? std::min(interval * 2, CAN_RECV_MAX_DELAY) : CAN_RECV_MIN_INTERVAL;
+    const int64_t remaining = read_ts + interval - nanos_since_boot();
+    if (remaining > 0) {
+      std::this_thread::sleep_for(std::chrono::nanoseconds(remaining));
+    }
   }
 }
 
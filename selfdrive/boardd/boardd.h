@@ -6,4 +6,6 @@
 #include "selfdrive/boardd/panda.h"
 
 bool safety_setter_thread(std::vector<Panda *> pandas);
+void can_send_thread(std::vector<Panda *> pandas, bool fake_send);
+void can_recv_thread(std::vector<Panda *> pandas);
 void boardd_main_thread(std::vector<std::string> serials);
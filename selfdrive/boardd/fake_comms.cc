@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include "common/swaglog.h"
+#include "common/timing.h"
+#include "common/util.h"
+#include "selfdrive/boardd/panda.h"
+
+PandaFakeHandle::PandaFakeHandle(std::string path) : PandaCommsHandle(path) {
+  recording = util::read_file(path);
+  size_t pos = 0;
+  while (pos + sizeof(panda_bulk_record) <= recording.size()) {
+    panda_bulk_record r;
+    memcpy(&r, &recording[pos], sizeof(r));
+    pos += sizeof(r);
+    if (pos + r.size > recording.size()) break;
+
+    records.push_back({.nanos = r.nanos, .offset = pos, .size = r.size});
+    pos += r.size;
+  }
+  if (records.empty()) {
+    throw std::runtime_error("Error reading panda recording " + path);
+  }
+  hw_serial = "fake";
+  LOGW("replaying %zu bulk reads from %s", records.size(), path.c_str());
+}
+
+int PandaFakeHandle::control_write(uint8_t request, uint16_t param1, uint16_t param2, unsigned int timeout) {
+  return 0;
+}
+
+int PandaFakeHandle::control_read(uint8_t request, uint16_t param1, uint16_t param2, unsigned char *data, uint16_t length, unsigned int timeout) {
+  memset(data, 0, length);
+  return length;
+}
+
+int PandaFakeHandle::bulk_write(unsigned char endpoint, unsigned char *data, int length, unsigned int timeout) {
+  return length;
+}
+
+int PandaFakeHandle::bulk_read(unsigned char endpoint, unsigned char *data, int length, unsigned int timeout) {
+  if (!connected) {
+    return 0;
+  }
+
+  // everything recorded up to the time since the first read is waiting in the panda
+  if (start_ts == 0) {
+    start_ts = nanos_since_boot();
+  }
+  const uint64_t now = records[0].nanos + (nanos_since_boot() - start_ts);
+
+  int transferred = 0;
+  while (record_idx < records.size() && records[record_idx].nanos <= now && transferred < length) {
+    const Record &r = records[record_idx];
+    const size_t size = std::min<size_t>(r.size - record_pos, length - transferred);
+    memcpy(&data[transferred], &recording[r.offset + record_pos], size);
+    transferred += size;
+    record_pos += size;
+    if (record_pos == r.size) {
+      ++record_idx;
+      record_pos = 0;
+    }
+  }
+
+  if (record_idx == records.size()) {
+    connected = false;
+  }
+  return transferred;
+}
+
+// PandaSimHandle
+
+// the panda queues up to this many received frames
+const size_t SIM_RX_QUEUE_FRAMES = 0x1000;
+
+// seconds a frame takes on the bus, with ~20% for bit stuffing. CAN-FD switches to the data
+// rate after the arbitration field.
+static double sim_frame_time(const PandaSimConfig &config, uint8_t len) {
+  if (!config.can_fd) {
+    return 1.2 * (47 + 8 * len) / (config.can_speed_kbps * 1e3);
+  }
+  return 1.2 * (30 / (config.can_speed_kbps * 1e3) + (8 * len + 28) / (config.data_speed_kbps * 1e3));
+}
+
+PandaSimHandle::PandaSimHandle(const PandaSimConfig &c) : PandaCommsHandle("sim"), config(c),
+    data_len(c.can_fd ? 64 : 8), frames_per_sec(c.bus_load / sim_frame_time(c, data_len)) {
+  hw_serial = "sim";
+}
+
+int PandaSimHandle::control_write(uint8_t request, uint16_t param1, uint16_t param2, unsigned int timeout) {
+  return 0;
+}
+
+int PandaSimHandle::control_read(uint8_t request, uint16_t param1, uint16_t param2, unsigned char *data, uint16_t length, unsigned int timeout) {
+  memset(data, 0, length);
+  return length;
+}
+
+int PandaSimHandle::bulk_write(unsigned char endpoint, unsigned char *data, int length, unsigned int timeout) {
+  std::lock_guard lk(lock);
+  const uint64_t now = nanos_since_boot();
+  tx_buf.append((const char *)data, length);
+
+  size_t pos = 0;
+  while (pos + sizeof(can_header) <= tx_buf.size()) {
+    can_header header;
+    memcpy(&header, &tx_buf[pos], sizeof(header));
+    const uint8_t len = dlc_to_len[header.data_len_code];
+    if (pos + sizeof(header) + len > tx_buf.size()) break;
+
+    const uint8_t *frame = (const uint8_t *)&tx_buf[pos];
+    if (Panda::calculate_checksum(frame, sizeof(header) + len) != 0) {
+      LOGE("sim panda: CAN checksum failed");
+      tx_buf.clear();
+      return length;
+    }
+
+    uint64_t published_ts = 0;
+    if (len >= sizeof(published_ts)) {
+      memcpy(&published_ts, frame + sizeof(header), sizeof(published_ts));
+    }
+    sent_frames.push_back({published_ts, now});
+    queueFrame(header.bus, header.addr, frame + sizeof(header), header.data_len_code, true);
+    pos += sizeof(header) + len;
+  }
+  tx_buf.erase(0, pos);
+  return length;
+}
+
+int PandaSimHandle::bulk_read(unsigned char endpoint, unsigned char *data, int length, unsigned int timeout) {
+  std::lock_guard lk(lock);
+  const uint64_t now = nanos_since_boot();
+  if (start_ts == 0) {
+    start_ts = now;
+  }
+
+  // put the frames that arrived since the last read on every bus
+  const uint64_t due = (now - start_ts) / 1e9 * frames_per_sec;
+  const uint8_t dlc = config.can_fd ? 15 : 8;
+  uint8_t dat[64] = {};
+  for (; generated < due; ++generated) {
+    const uint64_t wire_ts = start_ts + generated / frames_per_sec * 1e9;
+    memcpy(dat, &wire_ts, sizeof(wire_ts));
+    for (int bus = 0; bus < config.buses; ++bus) {
+      queueFrame(bus, 0x100 + generated % 64, dat, dlc, false);
+    }
+  }
+
+  const size_t size = std::min(rx_queue.size() - rx_pos, (size_t)length);
+  memcpy(data, &rx_queue[rx_pos], size);
+  rx_pos += size;
+  if (rx_pos > rx_queue.size() / 2) {
+    rx_queue.erase(0, rx_pos);
+    rx_pos = 0;
+  }
+  return size;
+}
+
+void PandaSimHandle::queueFrame(uint8_t bus, uint32_t address, const uint8_t *dat, uint8_t dlc, bool returned) {
+  if (rx_queue.size() - rx_pos >= SIM_RX_QUEUE_FRAMES * (sizeof(can_header) + data_len)) {
+    ++rx_dropped;
+    return;
+  }
+
+  const uint8_t len = dlc_to_len[dlc];
+  uint8_t frame[sizeof(can_header) + 64];
+  can_header header = {};
+  header.bus = bus;
+  header.data_len_code = dlc;
+  header.returned = returned;
+  header.extended = (address >= 0x800) ? 1 : 0;
+  header.addr = address;
+  memcpy(frame, &header, sizeof(header));
+  memcpy(&frame[sizeof(header)], dat, len);
+  ((can_header *)frame)->checksum = Panda::calculate_checksum(frame, sizeof(header) + len);
+  rx_queue.append((const char *)frame, sizeof(header) + len);
+}
+
+std::vector<std::pair<uint64_t, uint64_t>> PandaSimHandle::takeSentFrames() {
+  std::lock_guard lk(lock);
+  return std::exchange(sent_frames, {});
+}
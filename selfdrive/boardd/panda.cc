@@ -8,6 +8,7 @@
 
 #include "cereal/messaging/messaging.h"
 #include "common/swaglog.h"
+#include "common/timing.h"
 #include "common/util.h"
 
 Panda::Panda(std::string serial, uint32_t bus_offset) : bus_offset(bus_offset) {
@@ -24,6 +25,14 @@ Panda::Panda(std::string serial, uint32_t bus_offset) : bus_offset(bus_offset) {
 #endif
   }
 
+  init();
+}
+
+Panda::Panda(std::unique_ptr<PandaCommsHandle> comms, uint32_t bus_offset) : handle(std::move(comms)), bus_offset(bus_offset) {
+  init();
+}
+
+void Panda::init() {
   hw_type = get_hw_type();
   has_rtc = (hw_type == cereal::PandaState::PandaType::UNO) ||
             (hw_type == cereal::PandaState::PandaType::DOS) ||
@@ -31,7 +40,9 @@ Panda::Panda(std::string serial, uint32_t bus_offset) : bus_offset(bus_offset) {
 
   can_reset_communications();
 
-  return;
+  if (const char *dir = getenv("PANDA_BULK_RECORD")) {
+    bulk_record = std::make_unique<std::ofstream>(std::string(dir) + "/" + hw_serial() + ".bulk", std::ios::binary);
+  }
 }
 
 bool Panda::connected() {
@@ -251,7 +262,7 @@ void Panda::can_send(capnp::List<cereal::CanData>::Reader can_data_list) {
   });
 }
 
-bool Panda::can_receive(std::vector<can_frame>& out_vec) {
+bool Panda::can_receive(std::vector<can_recv_frame>& out_vec) {
   // Check if enough space left in buffer to store RECV_SIZE data
   assert(receive_buffer_size + RECV_SIZE <= sizeof(receive_buffer));
 
@@ -259,9 +270,15 @@ bool Panda::can_receive(std::vector<can_frame>& out_vec) {
   if (!comms_healthy()) {
     return false;
   }
-  if (recv == RECV_SIZE) {
+  recv_full = (recv == RECV_SIZE);
+  if (recv_full) {
     LOGW("Panda receive buffer full");
   }
+  if (bulk_record && recv > 0) {
+    panda_bulk_record record = {.nanos = nanos_since_boot(), .size = (uint32_t)recv};
+    bulk_record->write((const char *)&record, sizeof(record));
+    bulk_record->write((const char *)&receive_buffer[receive_buffer_size], recv);
+  }
   receive_buffer_size += recv;
 
   return (recv <= 0) ? true : unpack_can_buffer(receive_buffer, receive_buffer_size, out_vec);
@@ -271,7 +288,7 @@ void Panda::can_reset_communications() {
   handle->control_write(0xc0, 0, 0);
 }
 
-bool Panda::unpack_can_buffer(uint8_t *data, uint32_t &size, std::vector<can_frame> &out_vec) {
+bool Panda::unpack_can_buffer(uint8_t *data, uint32_t &size, std::vector<can_recv_frame> &out_vec) {
   int pos = 0;
 
   while (pos <= size - sizeof(can_header)) {
@@ -284,8 +301,7 @@ bool Panda::unpack_can_buffer(uint8_t *data, uint32_t &size, std::vector<can_fra
       break;
     }
 
-    can_frame &canData = out_vec.emplace_back();
-    canData.busTime = 0;
+    can_recv_frame &canData = out_vec.emplace_back();
     canData.address = header.addr;
     canData.src = header.bus + bus_offset;
     if (header.rejected) {
@@ -297,11 +313,13 @@ bool Panda::unpack_can_buffer(uint8_t *data, uint32_t &size, std::vector<can_fra
 
     if (calculate_checksum(&data[pos], sizeof(can_header) + data_len) != 0) {
       LOGE("Panda CAN checksum failed");
+      canData.len = 0;
       size = 0;
       return false;
     }
 
-    canData.dat.assign((char *)&data[pos + sizeof(can_header)], data_len);
+    canData.len = data_len;
+    memcpy(canData.dat, &data[pos + sizeof(can_header)], data_len);
 
     pos += sizeof(can_header) + data_len;
   }
@@ -313,7 +331,7 @@ bool Panda::unpack_can_buffer(uint8_t *data, uint32_t &size, std::vector<can_fra
   return true;
 }
 
-uint8_t Panda::calculate_checksum(uint8_t *data, uint32_t len) {
+uint8_t Panda::calculate_checksum(const uint8_t *data, uint32_t len) {
   uint8_t checksum = 0U;
   for (uint32_t i = 0U; i < len; i++) {
     checksum ^= data[i];
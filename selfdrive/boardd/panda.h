@@ -2,6 +2,7 @@
 
 #include <cstdint>
 #include <ctime>
+#include <fstream>
 #include <functional>
 #include <list>
 #include <memory>
@@ -19,6 +20,8 @@
 #define USBPACKET_MAX_SIZE  (0x40)
 
 #define RECV_SIZE (0x4000U)
+// most frames a single can_receive can unpack, the leftover of the previous read plus RECV_SIZE of empty frames
+#define CAN_RECV_FRAMES_MAX ((RECV_SIZE + sizeof(can_header) + CANPACKET_DATA_SIZE_MAX) / sizeof(can_header))
 
 #define CAN_REJECTED_BUS_OFFSET   0xC0U
 #define CAN_RETURNED_BUS_OFFSET 0x80U
@@ -41,13 +44,25 @@ struct can_frame {
   long src;
 };
 
+// received frame with the payload stored inline, so the receive buffer is reused without allocating
+struct can_recv_frame {
+  uint32_t address;
+  uint8_t src;
+  uint8_t len;
+  uint8_t dat[CANPACKET_DATA_SIZE_MAX];
+};
+
 
 class Panda {
 private:
   std::unique_ptr<PandaCommsHandle> handle;
+  std::unique_ptr<std::ofstream> bulk_record;
+  bool recv_full = false;
+  void init();
 
 public:
   Panda(std::string serial="", uint32_t bus_offset=0);
+  Panda(std::unique_ptr<PandaCommsHandle> comms, uint32_t bus_offset=0);
 
   cereal::PandaState::PandaType hw_type = cereal::PandaState::PandaType::UNKNOWN;
   bool has_rtc = false;
@@ -82,8 +97,12 @@ public:
   void set_data_speed_kbps(uint16_t bus, uint16_t speed);
   void set_canfd_non_iso(uint16_t bus, bool non_iso);
   void can_send(capnp::List<cereal::CanData>::Reader can_data_list);
-  bool can_receive(std::vector<can_frame>& out_vec);
+  bool can_receive(std::vector<can_recv_frame>& out_vec);
+  // the last can_receive filled RECV_SIZE, more data is likely waiting in the panda
+  bool can_receive_full() const { return recv_full; }
   void can_reset_communications();
+  // XOR of the header and data of a CAN frame, zero for a frame with a valid checksum
+  static uint8_t calculate_checksum(const uint8_t *data, uint32_t len);
 
 protected:
   // for unit tests
@@ -93,6 +112,5 @@ protected:
   Panda(uint32_t bus_offset) : bus_offset(bus_offset) {}
   void pack_can_buffer(const capnp::List<cereal::CanData>::Reader &can_data_list,
                          std::function<void(uint8_t *, size_t)> write_func);
-  bool unpack_can_buffer(uint8_t *data, uint32_t &size, std::vector<can_frame> &out_vec);
-  uint8_t calculate_checksum(uint8_t *data, uint32_t len);
+  bool unpack_can_buffer(uint8_t *data, uint32_t &size, std::vector<can_recv_frame> &out_vec);
 };
@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <mutex>
 #include <string>
+#include <utility>
 #include <vector>
 
 #ifndef __APPLE__
@@ -55,6 +56,80 @@ private:
   void handle_usb_issue(int err, const char func[]);
 };
 
+// a bulk read recorded with PANDA_BULK_RECORD, followed by size bytes of data
+struct __attribute__((packed)) panda_bulk_record {
+  uint64_t nanos;
+  uint32_t size;
+};
+
+// Replays bulk reads recorded with PANDA_BULK_RECORD=<dir> at their recorded pace, to exercise
+// the CAN receive path without hardware. Control transfers and bulk writes are ignored,
+// the handle disconnects at the end of the recording.
+class PandaFakeHandle : public PandaCommsHandle {
+public:
+  PandaFakeHandle(std::string path);
+  ~PandaFakeHandle() {}
+  int control_write(uint8_t request, uint16_t param1, uint16_t param2, unsigned int timeout=TIMEOUT);
+  int control_read(uint8_t request, uint16_t param1, uint16_t param2, unsigned char *data, uint16_t length, unsigned int timeout=TIMEOUT);
+  int bulk_write(unsigned char endpoint, unsigned char* data, int length, unsigned int timeout=TIMEOUT);
+  int bulk_read(unsigned char endpoint, unsigned char* data, int length, unsigned int timeout=TIMEOUT);
+  void cleanup() {}
+
+private:
+  struct Record {
+    uint64_t nanos;
+    size_t offset;
+    size_t size;
+  };
+  std::string recording;
+  std::vector<Record> records;
+  size_t record_idx = 0;
+  size_t record_pos = 0;
+  uint64_t start_ts = 0;
+};
+
+// Emulates a panda on the bulk endpoints. Every bus receives frames at the configured bus load,
+// framed with a can_header and checksum the way the panda sends them, and bulk writes are
+// parsed and echoed back as returned frames. The first 8 bytes of a received frame hold the time
+// it was put on the wire, and the first 8 bytes of a sent frame are expected to hold the time it
+// was published, for measuring latency.
+struct PandaSimConfig {
+  double bus_load = 0.3;  // fraction of the bus bandwidth
+  int buses = 3;
+  int can_speed_kbps = 500;
+  int data_speed_kbps = 2000;
+  bool can_fd = false;  // 64 byte frames instead of 8
+};
+
+class PandaSimHandle : public PandaCommsHandle {
+public:
+  PandaSimHandle(const PandaSimConfig &config);
+  ~PandaSimHandle() {}
+  int control_write(uint8_t request, uint16_t param1, uint16_t param2, unsigned int timeout=TIMEOUT);
+  int control_read(uint8_t request, uint16_t param1, uint16_t param2, unsigned char *data, uint16_t length, unsigned int timeout=TIMEOUT);
+  int bulk_write(unsigned char endpoint, unsigned char* data, int length, unsigned int timeout=TIMEOUT);
+  int bulk_read(unsigned char endpoint, unsigned char* data, int length, unsigned int timeout=TIMEOUT);
+  void cleanup() {}
+
+  // sent frames as (published, on the wire) times, and received frames dropped on a full panda queue
+  std::vector<std::pair<uint64_t, uint64_t>> takeSentFrames();
+  std::atomic<uint64_t> rx_dropped = 0;
+
+private:
+  void queueFrame(uint8_t bus, uint32_t address, const uint8_t *dat, uint8_t dlc, bool returned);
+
+  const PandaSimConfig config;
+  const uint8_t data_len;
+  const double frames_per_sec;
+  std::mutex lock;
+  uint64_t start_ts = 0;
+  uint64_t generated = 0;
+  std::string rx_queue;
+  size_t rx_pos = 0;
+  std::string tx_buf;
+  std::vector<std::pair<uint64_t, uint64_t>> sent_frames;
+};
+
 #ifndef __APPLE__
 class PandaSpiHandle : public PandaCommsHandle {
 public:
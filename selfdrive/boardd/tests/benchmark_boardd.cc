@@ -0,0 +1,174 @@
+// Runs the boardd CAN send and receive threads against a PandaSimHandle, and reports the
+// latency from the wire to `can` for received frames, from `sendcan` to the wire for sent
+// frames, and from `sendcan` back to `can` for their echoes. Set BOARDD_ADAPTIVE_CAN_RECV=1
+// to compare the adaptive receive mode with the fixed 100Hz.
+//
+// With --replay, the receive thread reads a recording made with PANDA_BULK_RECORD=<dir> through
+// PandaFakeHandle instead, at the recorded pace, and the batching of real traffic is reported.
+//
+// usage: benchmark_boardd [seconds] [bus_load] [canfd]
+//        benchmark_boardd --replay <recording>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "cereal/messaging/messaging.h"
+#include "common/timing.h"
+#include "selfdrive/boardd/boardd.h"
+
+const int SENDCAN_FRAMES = 10;
+
+static void print_latency(const char *name, std::vector<uint64_t> &v) {
+  if (v.empty()) {
+    printf("%-16s no frames\n", name);
+    return;
+  }
+  std::sort(v.begin(), v.end());
+  auto percentile = [&](double p) { return v[std::min(v.size() - 1, (size_t)(p * v.size()))] / 1e6; };
+  printf("%-16s %8zu frames  p50 %6.2f ms  p90 %6.2f ms  p99 %6.2f ms  max %6.2f ms\n", name, v.size(),
+         percentile(0.5), percentile(0.9), percentile(0.99), v.back() / 1e6);
+}
+
+// publish sendcan at 100Hz like controlsd, with the publish time in every frame
+static void sendcan_thread(std::atomic<bool> *running, int data_len) {
+  PubMaster pm({"sendcan"});
+  uint8_t dat[64] = {};
+  while (*running) {
+    MessageBuilder msg;
+    auto can_data = msg.initEvent().initSendcan(SENDCAN_FRAMES);
+    const uint64_t ts = nanos_since_boot();
+    memcpy(dat, &ts, sizeof(ts));
+    for (int i = 0; i < SENDCAN_FRAMES; ++i) {
+      can_data[i].setAddress(0x200 + i);
+      can_data[i].setDat(kj::arrayPtr(dat, data_len));
+      can_data[i].setSrc(0);
+    }
+    pm.send("sendcan", msg);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+}
+
+static int replay(const char *recording) {
+  Panda panda(std::make_unique<PandaFakeHandle>(recording));
+  std::vector<Panda *> pandas = {&panda};
+
+  std::unique_ptr<Context> context(Context::create());
+  std::unique_ptr<SubSocket> can_sock(SubSocket::create(context.get(), "can"));
+  assert(can_sock != nullptr);
+  can_sock->setTimeout(100);
+
+  // the receive thread exits when the recording ends
+  std::atomic<bool> done = false;
+  std::thread recv_thread([&]() {
+    can_recv_thread(pandas);
+    done = true;
+  });
+
+  size_t can_msgs = 0, frames = 0, max_batch = 0;
+  uint64_t first_ts = 0, last_ts = 0;
+  AlignedBuffer aligned_buf;
+  while (true) {
+    std::unique_ptr<Message> msg(can_sock->receive());
+    if (!msg) {
+      // drained everything published before the receive thread exited
+      if (done) break;
+      continue;
+    }
+
+    capnp::FlatArrayMessageReader cmsg(aligned_buf.align(msg.get()));
+    const size_t batch = cmsg.getRoot<cereal::Event>().getCan().size();
+    last_ts = nanos_since_boot();
+    first_ts = first_ts ? first_ts : last_ts;
+    ++can_msgs;
+    frames += batch;
+    max_batch = std::max(max_batch, batch);
+  }
+  recv_thread.join();
+
+  printf("replayed %s over %.1fs, %s receive\n", recording, (last_ts - first_ts) / 1e9,
+         getenv("BOARDD_ADAPTIVE_CAN_RECV") ? "adaptive" : "100Hz");
+  printf("%zu can messages, %zu frames, %.1f frames/message (max %zu)\n", can_msgs, frames,
+         frames / (double)std::max<size_t>(1, can_msgs), max_batch);
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc > 1 && strcmp(argv[1], "--replay") == 0) {
+    if (argc < 3) {
+      fprintf(stderr, "usage: %s --replay <recording>\n", argv[0]);
+      return 1;
+    }
+    return replay(argv[2]);
+  }
+
+  const double seconds = argc > 1 ? atof(argv[1]) : 10;
+  PandaSimConfig config;
+  config.bus_load = argc > 2 ? atof(argv[2]) : config.bus_load;
+  config.can_fd = argc > 3 && atoi(argv[3]) != 0;
+  const int data_len = config.can_fd ? 64 : 8;
+
+  auto sim = std::make_unique<PandaSimHandle>(config);
+  PandaSimHandle *handle = sim.get();
+  Panda panda(std::move(sim));
+  std::vector<Panda *> pandas = {&panda};
+
+  std::unique_ptr<Context> context(Context::create());
+  std::unique_ptr<SubSocket> can_sock(SubSocket::create(context.get(), "can"));
+  assert(can_sock != nullptr);
+  can_sock->setTimeout(100);
+
+  std::atomic<bool> running = true;
+  std::thread recv_thread(can_recv_thread, pandas);
+  std::thread send_thread(can_send_thread, pandas, false);
+  std::thread publish_thread(sendcan_thread, &running, data_len);
+
+  std::vector<uint64_t> rx_latency, echo_latency;
+  size_t can_msgs = 0, max_batch = 0;
+  AlignedBuffer aligned_buf;
+  const uint64_t end_ts = nanos_since_boot() + seconds * 1e9;
+  while (nanos_since_boot() < end_ts) {
+    std::unique_ptr<Message> msg(can_sock->receive());
+    if (!msg) continue;
+
+    const uint64_t recv_ts = nanos_since_boot();
+    capnp::FlatArrayMessageReader cmsg(aligned_buf.align(msg.get()));
+    auto frames = cmsg.getRoot<cereal::Event>().getCan();
+    ++can_msgs;
+    max_batch = std::max<size_t>(max_batch, frames.size());
+    for (const auto &c : frames) {
+      uint64_t ts = 0;
+      auto dat = c.getDat();
+      if (dat.size() < sizeof(ts)) continue;
+
+      memcpy(&ts, dat.begin(), sizeof(ts));
+      (c.getSrc() >= CAN_RETURNED_BUS_OFFSET ? echo_latency : rx_latency).push_back(recv_ts - ts);
+    }
+  }
+
+  running = false;
+  handle->connected = false;
+  publish_thread.join();
+  send_thread.join();
+  recv_thread.join();
+
+  std::vector<uint64_t> tx_latency;
+  for (auto [published_ts, wire_ts] : handle->takeSentFrames()) {
+    tx_latency.push_back(wire_ts - published_ts);
+  }
+
+  printf("%.0fs, bus load %.0f%%, %s frames, %s receive\n", seconds, config.bus_load * 100, config.can_fd ? "64 byte CAN-FD" : "8 byte CAN",
+         getenv("BOARDD_ADAPTIVE_CAN_RECV") ? "adaptive" : "100Hz");
+  printf("%zu can messages, %.1f frames/message (max %zu), %lu frames dropped by the panda\n", can_msgs,
+         (rx_latency.size() + echo_latency.size()) / (double)std::max<size_t>(1, can_msgs), max_batch, (unsigned long)handle->rx_dropped);
+  print_latency("wire -> can", rx_latency);
+  print_latency("sendcan -> wire", tx_latency);
+  print_latency("sendcan -> can", echo_latency);
+  return 0;
+}
@@ -0,0 +1,59 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "selfdrive/boardd/panda.h"
+
+// records the bulk reads of a simulated panda with PANDA_BULK_RECORD, replays them with
+// PandaFakeHandle and checks that can_receive unpacks the same frames
+TEST_CASE("PandaFakeHandle replays a PANDA_BULK_RECORD recording") {
+  PandaSimConfig config;
+  config.can_fd = GENERATE(false, true);
+
+  char dir[] = "/tmp/boardd_bulk_XXXXXX";
+  REQUIRE(mkdtemp(dir) != nullptr);
+
+  std::vector<can_recv_frame> recorded;
+  setenv("PANDA_BULK_RECORD", dir, 1);
+  {
+    Panda panda(std::make_unique<PandaSimHandle>(config));
+    for (int i = 0; i < 50; ++i) {
+      REQUIRE(panda.can_receive(recorded));
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+  }
+  unsetenv("PANDA_BULK_RECORD");
+  REQUIRE(recorded.size() > 0);
+
+  const std::string recording = std::string(dir) + "/sim.bulk";
+  std::vector<can_recv_frame> replayed;
+  {
+    Panda panda(std::make_unique<PandaFakeHandle>(recording));
+    REQUIRE(panda.hw_serial() == "fake");
+    while (panda.connected()) {
+      REQUIRE(panda.can_receive(replayed));
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+
+  REQUIRE(replayed.size() == recorded.size());
+  for (size_t i = 0; i < recorded.size(); ++i) {
+    INFO("frame " << i);
+    REQUIRE(replayed[i].address == recorded[i].address);
+    REQUIRE(replayed[i].src == recorded[i].src);
+    REQUIRE(replayed[i].len == recorded[i].len);
+    REQUIRE(memcmp(replayed[i].dat, recorded[i].dat, recorded[i].len) == 0);
+  }
+
+  unlink(recording.c_str());
+  rmdir(dir);
+}
@@ -9,6 +9,7 @@ from json import load
 from typing import Any, Callable, Dict, List, NamedTuple, Optional, Tuple, Union
 
 from cereal import car
+from opendbc.can.parser import CANParserGroup
 from openpilot.common.basedir import BASEDIR
 from openpilot.common.conversions import Conversions as CV
 from openpilot.common.simple_kalman import KF1D, get_kalman_gain
@@ -194,6 +195,7 @@ class CarInterfaceBase(ABC):
 
     self.CS = None
     self.can_parsers = []
+    self.can_parser_group = None
     if CarState is not None:
       self.CS = CarState(CP)
 
@@ -203,6 +205,7 @@ class CarInterfaceBase(ABC):
       self.cp_body = self.CS.get_body_can_parser(CP)
       self.cp_loopback = self.CS.get_loopback_can_parser(CP)
       self.can_parsers = [self.cp, self.cp_cam, self.cp_adas, self.cp_body, self.cp_loopback]
+      self.can_parser_group = CANParserGroup([cp for cp in self.can_parsers if cp is not None])
 
     self.CC = None
     if CarController is not None:
@@ -349,10 +352,9 @@ class CarInterfaceBase(ABC):
     pass
 
   def update(self, c: car.CarControl, can_strings: List[bytes], frogpilot_variables) -> car.CarState:
-    # parse can
-    for cp in self.can_parsers:
-      if cp is not None:
-        cp.update_strings(can_strings)
+    # parse can, each packet is decoded once for all buses
+    if self.can_parser_group is not None:
+      self.can_parser_group.update_strings(can_strings)
 
     # get CarState
     ret = self._update(c, frogpilot_variables)
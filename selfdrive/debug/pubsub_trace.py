@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+# Merges the pubsub trace rings of all processes into a Chrome/Perfetto trace, and prints
+# send to receive latency per service. Run openpilot with PUBSUB_TRACE=1 to record them,
+# see cereal/messaging/trace.h. Open the output in https://ui.perfetto.dev
+import argparse
+import glob
+import json
+import os
+import struct
+from collections import defaultdict
+
+import numpy as np
+
+MAGIC = 0x31454341525442
+HEADER = struct.Struct("<QIi16sQ")
+EVENT = struct.Struct("<QQQIIII32s")
+TYPES = ["send", "recv", "vipc_send", "vipc_recv"]
+
+
+def ring_paths():
+  prefix = os.getenv("OPENPILOT_PREFIX")
+  shm = os.path.join("/dev/shm", prefix) if prefix else "/dev/shm"
+  return sorted(glob.glob(os.path.join(shm, "pubsub_trace_*")))
+
+
+def read_ring(path):
+  with open(path, "rb") as f:
+    dat = f.read()
+  if len(dat) < HEADER.size:
+    return None, []
+
+  magic, capacity, pid, comm, write_index = HEADER.unpack_from(dat)
+  if magic != MAGIC or len(dat) < HEADER.size + capacity * EVENT.size:
+    return None, []
+
+  events = []
+  for slot, (seq, t, msg_id, typ, tid, size, drain_index, name) in enumerate(EVENT.iter_unpack(dat[HEADER.size:HEADER.size + capacity * EVENT.size])):
+    # skip empty slots and events that were being written
+    if seq == 0 or seq > write_index or (seq - 1) % capacity != slot:
+      continue
+    events.append({"t": t, "id": msg_id, "type": TYPES[typ], "pid": pid, "tid": tid, "size": size, "drain_index": drain_index,
+                   "name": name.split(b"\0", 1)[0].decode()})
+  proc = {"pid": pid, "comm": comm.split(b"\0", 1)[0].decode(), "dropped": max(0, write_index - capacity)}
+  return proc, events
+
+
+def thread_name(pid, tid):
+  try:
+    with open(f"/proc/{pid}/task/{tid}/comm") as f:
+      return f.read().strip()
+  except OSError:
+    return None
+
+
+def build_trace(procs, events):
+  trace = []
+  for p in procs.values():
+    trace.append({"ph": "M", "name": "process_name", "pid": p["pid"], "args": {"name": p["comm"]}})
+  for pid, tid in {(e["pid"], e["tid"]) for e in events}:
+    name = thread_name(pid, tid)
+    if name is not None:
+      trace.append({"ph": "M", "name": "thread_name", "pid": pid, "tid": tid, "args": {"name": name}})
+
+  # events are sorted by time, so a receive matches the latest send with the same id before it
+  sends = {}
+  latencies = defaultdict(list)
+  for i, e in enumerate(events):
+    args = {"id": e["id"], "size": e["size"]}
+    if e["type"].endswith("recv"):
+      args["drain_index"] = e["drain_index"]
+    trace.append({"ph": "i", "s": "t", "name": f"{e['type']} {e['name']}", "cat": e["type"],
+                  "pid": e["pid"], "tid": e["tid"], "ts": e["t"] / 1e3, "args": args})
+
+    if e["type"].endswith("send"):
+      sends[(e["name"], e["id"])] = e
+      continue
+
+    send = sends.get((e["name"], e["id"]))
+    if send is not None:
+      latency_ms = (e["t"] - send["t"]) / 1e6
+      latencies[(e["name"], procs[e["pid"]]["comm"])].append(latency_ms)
+
+      # the message in flight, on the receiving process
+      flight = {"cat": "latency", "name": e["name"], "id": i, "pid": e["pid"], "tid": e["tid"]}
+      trace.append({**flight, "ph": "b", "ts": send["t"] / 1e3,
+                    "args": {"from": procs[send["pid"]]["comm"], "latency_ms": latency_ms}})
+      trace.append({**flight, "ph": "e", "ts": e["t"] / 1e3})
+  return trace, latencies
+
+
+if __name__ == "__main__":
+  parser = argparse.ArgumentParser(description="Merge pubsub trace rings into a Chrome/Perfetto JSON trace")
+  parser.add_argument("-o", "--output", default="pubsub_trace.json")
+  parser.add_argument("--clear", action="store_true", help="delete the rings after merging")
+  args = parser.parse_args()
+
+  procs, events = {}, []
+  for path in ring_paths():
+    proc, ring_events = read_ring(path)
+    if proc is not None:
+      procs[proc["pid"]] = proc
+      events += ring_events
+  events.sort(key=lambda e: e["t"])
+
+  if not events:
+    print("no trace events found, run with PUBSUB_TRACE=1")
+    exit(1)
+
+  trace, latencies = build_trace(procs, events)
+  with open(args.output, "w") as f:
+    json.dump({"traceEvents": trace, "displayTimeUnit": "ms"}, f)
+
+  duration = (events[-1]["t"] - events[0]["t"]) / 1e9
+  print(f"{len(events)} events from {len(procs)} processes over {duration:.1f} s, written to {args.output}")
+  for p in procs.values():
+    if p["dropped"]:
+      print(f"  {p['comm']} ({p['pid']}): ring wrapped, {p['dropped']} oldest events lost")
+
+  print(f"\n{'service':<32} {'receiver':<16} {'count':>7} {'p50 ms':>8} {'p99 ms':>8} {'max ms':>8}")
+  for (name, receiver), lat in sorted(latencies.items()):
+    p50, p99 = np.percentile(lat, [50, 99])
+    print(f"{name:<32} {receiver:<16} {len(lat):>7} {p50:>8.3f} {p99:>8.3f} {max(lat):>8.3f}")
+
+  if args.clear:
+    for path in ring_paths():
+      os.remove(path)
@@ -5,6 +5,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <vector>
 
 using namespace EKFS;
@@ -613,6 +614,16 @@ void Localizer::handle_msg(const cereal::Event::Reader& log) {
   this->update_reset_tracker();
 }
 
+// Feeds the messages in log time order, so the filter only rewinds for data that is genuinely late
+void Localizer::handle_msgs(std::vector<cereal::Event::Reader>& logs) {
+  std::stable_sort(logs.begin(), logs.end(), [](const cereal::Event::Reader &a, const cereal::Event::Reader &b) {
+    return a.getLogMonoTime() < b.getLogMonoTime();
+  });
+  for (const cereal::Event::Reader &log : logs) {
+    this->handle_msg(log);
+  }
+}
+
 kj::ArrayPtr<capnp::byte> Localizer::get_message_bytes(MessageBuilder& msg_builder, bool inputsOK,
                                                        bool sensorsOK, bool gpsOK, bool msgValid) {
   cereal::Event::Builder evt = msg_builder.initEvent();
@@ -693,7 +704,10 @@ int Localizer::locationd_thread() {
   const std::initializer_list<const char *> service_list = {gps_location_socket, "cameraOdometry", "liveCalibration",
                                                           "carState", "accelerometer", "gyroscope"};
 
-  SubMaster sm(service_list, {}, nullptr, {gps_location_socket});
+  // every sample is fed to the filter, the others are state and only the latest one matters
+  const std::initializer_list<const char *> drained_services = {gps_location_socket, "cameraOdometry", "accelerometer", "gyroscope"};
+
+  SubMaster sm(service_list, {}, nullptr, {gps_location_socket}, drained_services);
   PubMaster pm({"liveLocationKalman"});
 
   uint64_t cnt = 0;
@@ -703,16 +717,25 @@ int Localizer::locationd_thread() {
     this->observation_values_invalid.insert({service, 0.0});
   }
 
+  std::vector<cereal::Event::Reader> logs;
   while (!do_exit) {
     sm.update();
     if (filterInitialized){
       this->observation_timings_invalid_reset();
+      logs.clear();
       for (const char* service : service_list) {
-        if (sm.updated(service) && sm.valid(service)){
-          const cereal::Event::Reader log = sm[service];
-          this->handle_msg(log);
+        if (!sm.updated(service)) continue;
+
+        bool drained = std::any_of(drained_services.begin(), drained_services.end(), [=](const char *s) { return strcmp(s, service) == 0; });
+        if (drained) {
+          for (const cereal::Event::Reader &log : sm.messages(service)) {
+            if (log.getValid()) logs.push_back(log);
+          }
+        } else if (sm.valid(service)) {
+          logs.push_back(sm[service]);
         }
       }
+      this->handle_msgs(logs);
     } else {
       filterInitialized = sm.allAliveAndValid();
     }
@@ -743,10 +766,3 @@ int Localizer::locationd_thread() {
   }
   return 0;
 }
-
-int main() {
-  util::set_realtime_priority(5);
-
-  Localizer localizer;
-  return localizer.locationd_thread();
-}
@@ -6,6 +6,7 @@
 #include <memory>
 #include <map>
 #include <string>
+#include <vector>
 
 #include "cereal/messaging/messaging.h"
 #include "common/transformations/coordinates.hpp"
@@ -55,6 +56,7 @@ public:
 
   void handle_msg_bytes(const char *data, const size_t size);
   void handle_msg(const cereal::Event::Reader& log);
+  void handle_msgs(std::vector<cereal::Event::Reader>& logs);
   void handle_sensor(double current_time, const cereal::SensorEventData::Reader& log);
   void handle_gps(double current_time, const cereal::GpsLocationData::Reader& log, const double sensor_time_offset);
   void handle_gnss(double current_time, const cereal::GnssMeasurements::Reader& log);
@@ -0,0 +1,168 @@
+// Replays the locationd inputs of a log through the Localizer twice: conflated, feeding only the
+// latest message of each service per update in service order like locationd used to, and drained,
+// feeding every message in log time order. locationd is assumed to wake up every [update_ms] of
+// log time. Reports the dropped samples, the samples fed out of order that made the filter rewind,
+// and the CPU time per update.
+//
+// usage: benchmark_locationd <uncompressed rlog> [update_ms]
+
+#include <time.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cereal/messaging/messaging.h"
+#include "common/util.h"
+#include "selfdrive/locationd/locationd.h"
+
+struct LogMessage {
+  std::string service;
+  uint64_t mono_time;
+  cereal::Event::Reader event;
+};
+
+struct Result {
+  size_t fed = 0, dropped = 0, out_of_order = 0;
+  std::vector<double> update_us;
+};
+
+static double thread_cpu_us() {
+  struct timespec t;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+  return t.tv_sec * 1e6 + t.tv_nsec * 1e-3;
+}
+
+static Result run(const std::vector<LogMessage> &log, const std::vector<std::string> &service_list,
+                  const std::vector<std::string> &sample_services, LocalizerGnssSource source, uint64_t update_ns, bool drain) {
+  Localizer localizer(source);
+  Result res;
+  uint64_t latest_fed = 0;
+  std::vector<cereal::Event::Reader> logs;
+
+  size_t i = 0;
+  while (i < log.size()) {
+    // everything that arrived since the last update
+    uint64_t update_end = (log[i].mono_time / update_ns + 1) * update_ns;
+    std::map<std::string, std::vector<const LogMessage *>> received;
+    bool trigger = false;
+    for (; i < log.size() && log[i].mono_time < update_end; ++i) {
+      received[log[i].service].push_back(&log[i]);
+      trigger |= log[i].service == "cameraOdometry";
+    }
+
+    logs.clear();
+    for (const std::string &service : service_list) {
+      auto it = received.find(service);
+      if (it == received.end()) continue;
+
+      bool is_sample = std::find(sample_services.begin(), sample_services.end(), service) != sample_services.end();
+      size_t first = (drain && is_sample) ? 0 : it->second.size() - 1;
+      if (is_sample) res.dropped += first;
+      for (size_t j = first; j < it->second.size(); ++j) {
+        if (it->second[j]->event.getValid()) logs.push_back(it->second[j]->event);
+      }
+    }
+
+    double start = thread_cpu_us();
+    localizer.observation_timings_invalid_reset();
+    if (drain) {
+      localizer.handle_msgs(logs);
+    } else {
+      for (const cereal::Event::Reader &event : logs) localizer.handle_msg(event);
+    }
+    if (trigger) {
+      MessageBuilder msg_builder;
+      localizer.get_message_bytes(msg_builder, true, true, true, true);
+    }
+    res.update_us.push_back(thread_cpu_us() - start);
+
+    for (const cereal::Event::Reader &event : logs) {
+      res.out_of_order += event.getLogMonoTime() < latest_fed;
+      latest_fed = std::max(latest_fed, event.getLogMonoTime());
+    }
+    res.fed += logs.size();
+  }
+  return res;
+}
+
+static void print_result(const char *name, Result &res) {
+  std::vector<double> &v = res.update_us;
+  std::sort(v.begin(), v.end());
+  double total = 0;
+  for (double us : v) total += us;
+  auto percentile = [&](double p) { return v.empty() ? 0.0 : v[std::min(v.size() - 1, (size_t)(p * v.size()))]; };
+  printf("%-10s %8zu %8zu %8zu %8zu %9.1f %9.1f %9.1f %9.1f\n", name, res.fed, res.dropped, res.out_of_order, v.size(),
+         v.empty() ? 0.0 : total / v.size(), percentile(0.5), percentile(0.99), v.empty() ? 0.0 : v.back());
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <uncompressed rlog> [update_ms]\n", argv[0]);
+    return 1;
+  }
+  const uint64_t update_ns = (argc > 2 ? atof(argv[2]) : 10.0) * 1e6;
+
+  std::string raw = util::read_file(argv[1]);
+  if (raw.empty()) {
+    fprintf(stderr, "failed to read %s\n", argv[1]);
+    return 1;
+  }
+  kj::Array<capnp::word> words = kj::heapArray<capnp::word>(raw.size() / sizeof(capnp::word));
+  memcpy(words.begin(), raw.data(), words.size() * sizeof(capnp::word));
+  raw.clear();
+
+  std::vector<std::unique_ptr<capnp::FlatArrayMessageReader>> readers;
+  std::vector<LogMessage> log;
+  bool has_ublox = false;
+  capnp::ReaderOptions options;
+  options.traversalLimitInWords = kj::maxValue;
+  for (kj::ArrayPtr<const capnp::word> remaining = words; remaining.size() > 0;) {
+    auto reader = std::make_unique<capnp::FlatArrayMessageReader>(remaining, options);
+    remaining = kj::arrayPtr(reader->getEnd(), remaining.end());
+    cereal::Event::Reader event = reader->getRoot<cereal::Event>();
+
+    std::string service;
+    switch (event.which()) {
+      case cereal::Event::ACCELEROMETER: service = "accelerometer"; break;
+      case cereal::Event::GYROSCOPE: service = "gyroscope"; break;
+      case cereal::Event::CAMERA_ODOMETRY: service = "cameraOdometry"; break;
+      case cereal::Event::LIVE_CALIBRATION: service = "liveCalibration"; break;
+      case cereal::Event::CAR_STATE: service = "carState"; break;
+      case cereal::Event::GPS_LOCATION: service = "gpsLocation"; break;
+      case cereal::Event::GPS_LOCATION_EXTERNAL: service = "gpsLocationExternal"; has_ublox = true; break;
+      default: continue;
+    }
+    log.push_back({service, event.getLogMonoTime(), event});
+    readers.push_back(std::move(reader));
+  }
+  std::stable_sort(log.begin(), log.end(), [](const LogMessage &a, const LogMessage &b) { return a.mono_time < b.mono_time; });
+
+  // locationd uses the ublox when there is one
+  const std::string gps_service = has_ublox ? "gpsLocationExternal" : "gpsLocation";
+  const LocalizerGnssSource source = has_ublox ? LocalizerGnssSource::UBLOX : LocalizerGnssSource::QCOM;
+  log.erase(std::remove_if(log.begin(), log.end(), [&](const LogMessage &m) {
+    return m.service.rfind("gpsLocation", 0) == 0 && m.service != gps_service;
+  }), log.end());
+  if (log.empty()) {
+    fprintf(stderr, "no locationd inputs in %s\n", argv[1]);
+    return 1;
+  }
+
+  const std::vector<std::string> service_list = {gps_service, "cameraOdometry", "liveCalibration", "carState", "accelerometer", "gyroscope"};
+  const std::vector<std::string> sample_services = {gps_service, "cameraOdometry", "accelerometer", "gyroscope"};
+  printf("%zu messages over %.1f s, updates every %.1f ms\n\n", log.size(), (log.back().mono_time - log.front().mono_time) / 1e9, update_ns / 1e6);
+
+  Result conflated = run(log, service_list, sample_services, source, update_ns, false);
+  Result drained = run(log, service_list, sample_services, source, update_ns, true);
+
+  printf("%-10s %8s %8s %8s %8s %9s %9s %9s %9s\n", "mode", "fed", "dropped", "late", "updates", "mean us", "p50 us", "p99 us", "max us");
+  print_result("conflated", conflated);
+  print_result("drained", drained);
+  return 0;
+}
@@ -11,6 +11,7 @@ from typing import List, Tuple, Union
 
 from cereal import log
 import cereal.messaging as messaging
+from cereal.services import SERVICE_LIST
 import openpilot.selfdrive.sentry as sentry
 from openpilot.common.basedir import BASEDIR
 from openpilot.common.params import Params, ParamKeyType
@@ -361,6 +362,10 @@ def manager_thread() -> None:
   cloudlog.info("manager start")
   cloudlog.info({"environ": os.environ})
 
+  # every msgq segment can end up fully committed in /dev/shm, either on the first lap of the ring or up front with MSGQ_PREFAULT
+  msgq_shm_mb = sum(s.segment_size for s in SERVICE_LIST.values()) / 1e6
+  cloudlog.info(f"msgq: {msgq_shm_mb:.1f} MB of shm for {len(SERVICE_LIST)} services")
+
   params = Params()
   params_memory = Params("/dev/shm/params")
   params_storage = Params("/persist/comma/params")
@@ -0,0 +1,181 @@
+#include "system/loggerd/log_writer.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+
+#include "common/util.h"
+
+LogWriter::LogWriter(const std::string &path, int level, size_t buf_size, int num_buffers)
+    : compression_level(level), buffer_size(buf_size) {
+  assert(compression_level >= 0 && compression_level <= 9);
+  assert(num_buffers > 0);
+
+  fd = HANDLE_EINTR(open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0664));
+  assert(fd >= 0);
+
+  if (compression_level > 0) {
+    int ret = BZ2_bzCompressInit(&bz, compression_level, 0, 0);
+    assert(ret == BZ_OK);
+  }
+
+  current.reserve(buffer_size);
+  for (int i = 1; i < num_buffers; ++i) {
+    free_buffers.emplace_back();
+    free_buffers.back().reserve(buffer_size);
+  }
+  out.resize(buffer_size);
+
+  thread = std::thread(&LogWriter::writerThread, this);
+}
+
+LogWriter::~LogWriter() {
+  if (!current.empty()) {
+    queueBuffer();
+  }
+  {
+    std::lock_guard lk(lock);
+    exit = true;
+  }
+  cv.notify_all();
+  thread.join();
+
+  if (compression_level > 0) {
+    BZ2_bzCompressEnd(&bz);
+  }
+  int err = close(fd);
+  assert(err == 0);
+}
+
+void LogWriter::write(const void *data, size_t size) {
+  const char *p = (const char *)data;
+  while (size > 0) {
+    size_t n = std::min(size, buffer_size - current.size());
+    current.insert(current.end(), p, p + n);
+    p += n;
+    size -= n;
+    if (current.size() == buffer_size) {
+      queueBuffer();
+    }
+  }
+}
+
+void LogWriter::queueBuffer() {
+  std::unique_lock lk(lock);
+  stats_.bytes_in += current.size();
+  stats_.buffers++;
+  queue.push_back(std::move(current));
+  stats_.max_queued = std::max(stats_.max_queued, queue.size());
+  cv.notify_all();
+
+  if (free_buffers.empty()) {
+    // the disk or the compressor can't keep up, wait for the writer thread
+    auto start = std::chrono::steady_clock::now();
+    cv.wait(lk, [this] { return !free_buffers.empty(); });
+    stats_.stalls++;
+    stats_.stall_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
+  current = std::move(free_buffers.front());
+  free_buffers.pop_front();
+  current.clear();
+}
+
+LogWriter::Stats LogWriter::stats() {
+  std::lock_guard lk(lock);
+  return stats_;
+}
+
+void LogWriter::writerThread() {
+  util::set_thread_name("loggerd_writer");
+
+  while (true) {
+    std::vector<char> buf;
+    {
+      std::unique_lock lk(lock);
+      cv.wait(lk, [this] { return exit || !queue.empty(); });
+      if (queue.empty()) break;
+      buf = std::move(queue.front());
+      queue.pop_front();
+    }
+
+    if (compression_level > 0) {
+      compress(buf.data(), buf.size(), BZ_RUN);
+    } else {
+      output(buf.data(), buf.size(), false);
+    }
+
+    {
+      std::lock_guard lk(lock);
+      stats_.bytes_out = bytes_out;
+      free_buffers.push_back(std::move(buf));
+    }
+    cv.notify_all();
+  }
+
+  if (compression_level > 0) {
+    compress(nullptr, 0, BZ_FINISH);
+  }
+  output(nullptr, 0, true);
+
+  std::lock_guard lk(lock);
+  stats_.bytes_out = bytes_out;
+}
+
+void LogWriter::compress(const char *data, size_t size, int action) {
+  bz.next_in = (char *)data;
+  bz.avail_in = size;
+  while (true) {
+    bz.next_out = out.data() + out_size;
+    bz.avail_out = out.size() - out_size;
+    int ret = BZ2_bzCompress(&bz, action);
+    assert(ret == BZ_RUN_OK || ret == BZ_FINISH_OK || ret == BZ_STREAM_END);
+    out_size = out.size() - bz.avail_out;
+
+    if (out_size == out.size()) {
+      output(nullptr, 0, true);
+    }
+    if ((action == BZ_RUN && bz.avail_in == 0) || ret == BZ_STREAM_END) {
+      break;
+    }
+  }
+}
+
+static void write_all(int fd, const char *data, size_t size) {
+  size_t written = 0;
+  while (written < size) {
+    ssize_t ret = HANDLE_EINTR(::write(fd, data + written, size - written));
+    assert(ret > 0);
+    written += ret;
+  }
+}
+
+void LogWriter::output(const char *data, size_t size, bool flush) {
+  // full uncompressed buffers go straight to disk
+  if (out_size == 0 && size == out.size()) {
+    write_all(fd, data, size);
+    bytes_out += size;
+    size = 0;
+  }
+
+  // stage the rest into out, so the file is written in buffer sized chunks
+  while (size > 0) {
+    size_t n = std::min(size, out.size() - out_size);
+    memcpy(out.data() + out_size, data, n);
+    out_size += n;
+    data += n;
+    size -= n;
+    if (out_size == out.size()) {
+      output(nullptr, 0, true);
+    }
+  }
+
+  if (flush) {
+    write_all(fd, out.data(), out_size);
+    bytes_out += out_size;
+    out_size = 0;
+  }
+}
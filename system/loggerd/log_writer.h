@@ -0,0 +1,66 @@
+#pragma once
+
+#include <bzlib.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cereal/messaging/messaging.h"
+
+constexpr size_t LOG_WRITER_BUFFER_SIZE = 1024 * 1024;
+constexpr int LOG_WRITER_NUM_BUFFERS = 8;
+
+// Appends log data into preallocated buffers and hands full buffers to a background
+// thread, which optionally bz2 compresses them and writes them out in buffer sized writes.
+// write() only blocks when all buffers are queued (backpressure), which shows up in stats().
+class LogWriter {
+public:
+  struct Stats {
+    uint64_t bytes_in = 0;
+    uint64_t bytes_out = 0;
+    uint64_t buffers = 0;     // buffers handed to the writer thread
+    uint64_t stalls = 0;      // writes that waited for a free buffer
+    double stall_ms = 0;
+    size_t max_queued = 0;
+  };
+
+  // compression_level is the bz2 block size (1-9), 0 writes uncompressed
+  LogWriter(const std::string &path, int compression_level = 0,
+            size_t buffer_size = LOG_WRITER_BUFFER_SIZE, int num_buffers = LOG_WRITER_NUM_BUFFERS);
+  ~LogWriter();
+  void write(const void *data, size_t size);
+  inline void write(kj::ArrayPtr<capnp::byte> array) { write(array.begin(), array.size()); }
+  Stats stats();
+
+private:
+  void queueBuffer();
+  void writerThread();
+  void compress(const char *data, size_t size, int action);
+  void output(const char *data, size_t size, bool flush);
+
+  int fd = -1;
+  const int compression_level;
+  const size_t buffer_size;
+
+  // owned by the calling thread
+  std::vector<char> current;
+
+  std::mutex lock;
+  std::condition_variable cv;
+  std::deque<std::vector<char>> queue, free_buffers;
+  bool exit = false;
+  Stats stats_;
+
+  // owned by the writer thread
+  bz_stream bz = {};
+  std::vector<char> out;
+  size_t out_size = 0;
+  uint64_t bytes_out = 0;
+
+  std::thread thread;
+};
@@ -1,5 +1,6 @@
 #include "system/loggerd/logger.h"
 
+#include <cinttypes>
 #include <fstream>
 #include <map>
 #include <vector>
@@ -130,7 +131,7 @@ static void log_sentinel(LoggerState *log, SentinelType type, int eixt_signal =
   log->write(msg.toBytes(), true);
 }
 
-LoggerState::LoggerState(const std::string &log_root) {
+LoggerState::LoggerState(const std::string &log_root, int compression_level) : compression_level(compression_level) {
   route_name = logger_get_route_name();
   route_path = log_root + "/" + route_name;
   init_data = logger_build_init_data();
@@ -139,14 +140,32 @@ LoggerState::LoggerState(const std::string &log_root) {
 LoggerState::~LoggerState() {
   if (rlog) {
     log_sentinel(this, SentinelType::END_OF_ROUTE, exit_signal);
-    std::remove(lock_file.c_str());
+    closeSegment();
   }
 }
 
+static void close_log(const char *name, std::unique_ptr<LogWriter> &log) {
+  // flushes and waits for the writer thread
+  auto stats = log->stats();
+  log.reset();
+
+  if (stats.stalls > 0) {
+    LOGW("%s: writer stalled %" PRIu64 " times (%.1f ms), %zu max queued", name, stats.stalls, stats.stall_ms, stats.max_queued);
+  }
+  LOGD("%s: %" PRIu64 " bytes in, %" PRIu64 " bytes out", name, stats.bytes_in, stats.bytes_out);
+}
+
+void LoggerState::closeSegment() {
+  close_log("rlog", rlog);
+  close_log("qlog", qlog);
+  // only unlock the segment once everything is on disk
+  std::remove(lock_file.c_str());
+}
+
 bool LoggerState::next() {
   if (rlog) {
     log_sentinel(this, SentinelType::END_OF_SEGMENT);
-    std::remove(lock_file.c_str());
+    closeSegment();
   }
 
   segment_path = route_path + "--" + std::to_string(++part);
@@ -157,8 +176,9 @@ bool LoggerState::next() {
   lock_file = rlog_path + ".lock";
   std::ofstream{lock_file};
 
-  rlog.reset(new RawFile(rlog_path));
-  qlog.reset(new RawFile(segment_path + "/qlog"));
+  const std::string ext = compression_level > 0 ? ".bz2" : "";
+  rlog.reset(new LogWriter(rlog_path + ext, compression_level));
+  qlog.reset(new LogWriter(segment_path + "/qlog" + ext, compression_level));
 
   // log init data & sentinel type.
   write(init_data.asBytes(), true);
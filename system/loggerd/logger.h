@@ -7,6 +7,7 @@
 #include "cereal/messaging/messaging.h"
 #include "common/util.h"
 #include "system/hardware/hw.h"
+#include "system/loggerd/log_writer.h"
 
 class RawFile {
  public:
@@ -34,7 +35,8 @@ typedef cereal::Sentinel::SentinelType SentinelType;
 
 class LoggerState {
 public:
-  LoggerState(const std::string& log_root = Path::log_root());
+  // with compression_level > 0 segments are written as bz2 compressed rlog.bz2 and qlog.bz2
+  LoggerState(const std::string& log_root = Path::log_root(), int compression_level = 0);
   ~LoggerState();
   bool next();
   void write(uint8_t* data, size_t size, bool in_qlog);
@@ -45,10 +47,12 @@ public:
   inline void setExitSignal(int signal) { exit_signal = signal; }
 
 protected:
-  int part = -1, exit_signal = 0;
+  void closeSegment();
+
+  int part = -1, exit_signal = 0, compression_level = 0;
   std::string route_path, route_name, segment_path, lock_file;
   kj::Array<capnp::word> init_data;
-  std::unique_ptr<RawFile> rlog, qlog;
+  std::unique_ptr<LogWriter> rlog, qlog;
 };
 
 kj::Array<capnp::word> logger_build_init_data();
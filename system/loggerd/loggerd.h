@@ -27,6 +27,8 @@ const int QCAM_BITRATE = 256000;
 
 const bool LOGGERD_TEST = getenv("LOGGERD_TEST");
 const int SEGMENT_LENGTH = LOGGERD_TEST ? atoi(getenv("LOGGERD_SEGMENT_LENGTH")) : 60;
+// bz2 block size (1-9) for rlog/qlog, 0 writes them uncompressed
+const int LOGGERD_COMPRESSION_LEVEL = util::getenv("LOGGERD_COMPRESSION_LEVEL", 0);
 
 constexpr char PRESERVE_ATTR_NAME[] = "user.preserve";
 constexpr char PRESERVE_ATTR_VALUE = '1';
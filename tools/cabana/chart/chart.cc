@@ -280,16 +280,16 @@ void ChartView::updateSeriesPoints() {
   }
 }
 
-void ChartView::appendCanEvents(const cabana::Signal *sig, const std::vector<const CanEvent *> &events,
+void ChartView::appendCanEvents(const cabana::Signal *sig, const MessageEvents &events,
                                 std::vector<QPointF> &vals, std::vector<QPointF> &step_vals) {
-  vals.reserve(vals.size() + events.capacity());
-  step_vals.reserve(step_vals.size() + events.capacity() * 2);
+  vals.reserve(vals.size() + events.size());
+  step_vals.reserve(step_vals.size() + events.size() * 2);
 
   double value = 0;
   const uint64_t begin_mono_time = can->routeStartTime() * 1e9;
-  for (const CanEvent *e : events) {
-    if (sig->getValue(e->dat, e->size, &value)) {
-      const double ts = (e->mono_time - std::min(e->mono_time, begin_mono_time)) / 1e9;
+  for (const CanEvent e : events) {
+    if (sig->getValue(e.dat, e.size, &value)) {
+      const double ts = (e.mono_time - std::min(e.mono_time, begin_mono_time)) / 1e9;
       vals.emplace_back(ts, value);
       if (!step_vals.empty())
         step_vals.emplace_back(ts, step_vals.back().y());
@@ -309,7 +309,7 @@ void ChartView::updateSeries(const cabana::Signal *sig, const MessageEventsMap *
       auto it = events->find(s.msg_id);
       if (it == events->end() || it->second.empty()) continue;
 
-      if (s.vals.empty() || (it->second.back()->mono_time / 1e9 - can->routeStartTime()) > s.vals.back().x()) {
+      if (s.vals.empty() || (it->second.back().mono_time / 1e9 - can->routeStartTime()) > s.vals.back().x()) {
         appendCanEvents(s.sig, it->second, s.vals, s.step_vals);
       } else {
         std::vector<QPointF> vals, step_vals;
@@ -10,15 +10,15 @@ void Sparkline::update(const MessageId &msg_id, const cabana::Signal *sig, doubl
   const auto &msgs = can->events(msg_id);
   uint64_t ts = (last_msg_ts + can->routeStartTime()) * 1e9;
   uint64_t first_ts = (ts > range * 1e9) ? ts - range * 1e9 : 0;
-  auto first = std::lower_bound(msgs.cbegin(), msgs.cend(), first_ts, CompareCanEvent());
-  auto last = std::upper_bound(first, msgs.cend(), ts, CompareCanEvent());
+  auto first = msgs.lowerBound(first_ts);
+  auto last = msgs.upperBound(ts);
 
   if (first != last && !size.isEmpty()) {
     points.clear();
     double value = 0;
     for (auto it = first; it != last; ++it) {
-      if (sig->getValue((*it)->dat, (*it)->size, &value)) {
-        points.emplace_back(((*it)->mono_time - (*first)->mono_time) / 1e9, value);
+      if (sig->getValue(it->dat, it->size, &value)) {
+        points.emplace_back((it->mono_time - first->mono_time) / 1e9, value);
       }
     }
     const auto [min, max] = std::minmax_element(points.begin(), points.end(),
@@ -123,15 +123,15 @@ template <class InputIt>
 std::deque<HistoryLogModel::Message> HistoryLogModel::fetchData(InputIt first, InputIt last, uint64_t min_time) {
   std::deque<HistoryLogModel::Message> msgs;
   std::vector<double> values(sigs.size());
-  for (; first != last && (*first)->mono_time > min_time; ++first) {
-    const CanEvent *e = *first;
+  for (; first != last && (*first).mono_time > min_time; ++first) {
+    const CanEvent e = *first;
     for (int i = 0; i < sigs.size(); ++i) {
-      sigs[i]->getValue(e->dat, e->size, &values[i]);
+      sigs[i]->getValue(e.dat, e.size, &values[i]);
     }
     if (!filter_cmp || filter_cmp(values[filter_sig_idx], filter_value)) {
       auto &m = msgs.emplace_back();
-      m.mono_time = e->mono_time;
-      m.data.assign(e->dat, e->dat + e->size);
+      m.mono_time = e.mono_time;
+      m.data.assign(e.dat, e.dat + e.size);
       m.sig_values = values;
       if (msgs.size() >= batch_size && min_time == 0) {
         return msgs;
@@ -148,10 +148,8 @@ std::deque<HistoryLogModel::Message> HistoryLogModel::fetchData(uint64_t from_ti
   const std::vector<uint8_t> no_mask;
   const auto speed = can->getSpeed();
   if (dynamic_mode) {
-    auto first = std::upper_bound(events.rbegin(), events.rend(), from_time, [](uint64_t ts, auto e) {
-      return ts > e->mono_time;
-    });
-    auto msgs = fetchData(first, events.rend(), min_time);
+    auto first = std::make_reverse_iterator(events.lowerBound(from_time));
+    auto msgs = fetchData(first, std::make_reverse_iterator(events.begin()), min_time);
     if (update_colors && (min_time > 0 || messages.empty())) {
       for (auto it = msgs.rbegin(); it != msgs.rend(); ++it) {
         hex_colors.compute(msg_id, it->data.data(), it->data.size(), it->mono_time / (double)1e9, speed, no_mask, freq);
@@ -161,8 +159,7 @@ std::deque<HistoryLogModel::Message> HistoryLogModel::fetchData(uint64_t from_ti
     return msgs;
   } else {
     assert(min_time == 0);
-    auto first = std::upper_bound(events.cbegin(), events.cend(), from_time, CompareCanEvent());
-    auto msgs = fetchData(first, events.cend(), 0);
+    auto msgs = fetchData(events.upperBound(from_time), events.end(), 0);
     if (update_colors) {
       for (auto it = msgs.begin(); it != msgs.end(); ++it) {
         hex_colors.compute(msg_id, it->data.data(), it->data.size(), it->mono_time / (double)1e9, speed, no_mask, freq);
@@ -6,8 +6,6 @@
 #include "common/timing.h"
 #include "tools/cabana/settings.h"
 
-static const int EVENT_NEXT_BUFFER_SIZE = 6 * 1024 * 1024;  // 6MB
-
 AbstractStream *can = nullptr;
 
 StreamNotifier *StreamNotifier::instance() {
@@ -17,7 +15,6 @@ StreamNotifier *StreamNotifier::instance() {
 
 AbstractStream::AbstractStream(QObject *parent) : QObject(parent) {
   assert(parent != nullptr);
-  event_buffer_ = std::make_unique<MonotonicBuffer>(EVENT_NEXT_BUFFER_SIZE);
 
   QObject::connect(this, &AbstractStream::privateUpdateLastMsgsSignal, this, &AbstractStream::updateLastMessages, Qt::QueuedConnection);
   QObject::connect(this, &AbstractStream::seekedTo, this, &AbstractStream::updateLastMsgsTo);
@@ -112,8 +109,8 @@ void AbstractStream::updateEvent(const MessageId &id, double sec, const uint8_t
   new_msgs_.insert(id);
 }
 
-const std::vector<const CanEvent *> &AbstractStream::events(const MessageId &id) const {
-  static std::vector<const CanEvent *> empty_events;
+const MessageEvents &AbstractStream::events(const MessageId &id) const {
+  static MessageEvents empty_events;
   auto it = events_.find(id);
   return it != events_.end() ? it->second : empty_events;
 }
@@ -133,13 +130,13 @@ void AbstractStream::updateLastMsgsTo(double sec) {
   current_sec_ = sec;
   uint64_t last_ts = (sec + routeStartTime()) * 1e9;
   for (const auto &[id, ev] : events_) {
-    auto it = std::upper_bound(ev.begin(), ev.end(), last_ts, CompareCanEvent());
+    auto it = ev.upperBound(last_ts);
     if (it != ev.begin()) {
-      auto prev = std::prev(it);
-      double ts = (*prev)->mono_time / 1e9 - routeStartTime();
+      const CanEvent prev = *std::prev(it);
+      double ts = prev.mono_time / 1e9 - routeStartTime();
       auto &m = messages_[id];
-      m.compute(id, (*prev)->dat, (*prev)->size, ts, getSpeed(), {});
-      m.count = std::distance(ev.begin(), prev) + 1;
+      m.compute(id, prev.dat, prev.size, ts, getSpeed(), {});
+      m.count = it.index();
     }
   }
 
@@ -150,37 +147,150 @@ void AbstractStream::updateLastMsgsTo(double sec) {
   emit msgsReceived(nullptr, id_changed);
 }
 
-const CanEvent *AbstractStream::newEvent(uint64_t mono_time, const cereal::CanData::Reader &c) {
+void AbstractStream::addEvent(MessageEventsMap &events, uint64_t mono_time, const cereal::CanData::Reader &c) {
   auto dat = c.getDat();
-  CanEvent *e = (CanEvent *)event_buffer_->allocate(sizeof(CanEvent) + sizeof(uint8_t) * dat.size());
-  e->src = c.getSrc();
-  e->address = c.getAddress();
-  e->mono_time = mono_time;
-  e->size = dat.size();
-  memcpy(e->dat, (uint8_t *)dat.begin(), e->size);
-  return e;
+  events[{.source = (uint8_t)c.getSrc(), .address = c.getAddress()}].append(mono_time, (const uint8_t *)dat.begin(), dat.size());
 }
 
-void AbstractStream::mergeEvents(const std::vector<const CanEvent *> &events) {
-  static MessageEventsMap msg_events;
-  std::for_each(msg_events.begin(), msg_events.end(), [](auto &e) { e.second.clear(); });
-  for (auto e : events) {
-    msg_events[{.source = e->src, .address = e->address}].push_back(e);
+void AbstractStream::mergeEvents(const MessageEventsMap &events) {
+  bool merged = false;
+  for (const auto &[id, new_e] : events) {
+    if (!new_e.empty()) {
+      auto &e = events_[id];
+      e.merge(new_e);
+      first_event_ts_ = first_event_ts_ == 0 ? e.front().mono_time : std::min(first_event_ts_, e.front().mono_time);
+      lastest_event_ts = std::max(lastest_event_ts, e.back().mono_time);
+      merged = true;
+    }
+  }
+  if (merged) {
+    emit eventsMerged(events);
   }
+}
 
-  if (!events.empty()) {
-    for (const auto &[id, new_e] : msg_events) {
-      if (!new_e.empty()) {
-        auto &e = events_[id];
-        auto pos = std::upper_bound(e.cbegin(), e.cend(), new_e.front()->mono_time, CompareCanEvent());
-        e.insert(pos, new_e.cbegin(), new_e.cend());
-      }
+// MessageEvents
+
+MessageEvents::iterator &MessageEvents::iterator::operator++() {
+  if (++offset == events->chunks_[chunk].mono_times.size()) {
+    ++chunk;
+    offset = 0;
+  }
+  return *this;
+}
+
+MessageEvents::iterator &MessageEvents::iterator::operator--() {
+  if (offset == 0) {
+    offset = events->chunks_[--chunk].mono_times.size();
+  }
+  --offset;
+  return *this;
+}
+
+MessageEvents::iterator MessageEvents::lowerBound(uint64_t ts) const {
+  // the chunk before the first one starting at or after ts may still hold events >= ts
+  size_t chunk = std::lower_bound(chunk_times_.begin(), chunk_times_.end(), ts) - chunk_times_.begin();
+  if (chunk > 0) {
+    const auto &times = chunks_[chunk - 1].mono_times;
+    size_t offset = std::lower_bound(times.begin(), times.end(), ts) - times.begin();
+    if (offset < times.size()) return {this, chunk - 1, offset};
+  }
+  return {this, chunk, 0};
+}
+
+MessageEvents::iterator MessageEvents::upperBound(uint64_t ts) const {
+  size_t chunk = std::upper_bound(chunk_times_.begin(), chunk_times_.end(), ts) - chunk_times_.begin();
+  if (chunk > 0) {
+    const auto &times = chunks_[chunk - 1].mono_times;
+    size_t offset = std::upper_bound(times.begin(), times.end(), ts) - times.begin();
+    if (offset < times.size()) return {this, chunk - 1, offset};
+  }
+  return {this, chunk, 0};
+}
+
+void MessageEvents::append(uint64_t mono_time, const uint8_t *dat, uint8_t size) {
+  if (!empty() && mono_time < chunks_.back().mono_times.back()) {
+    // out of order, rare in practice
+    MessageEvents e;
+    e.append(mono_time, dat, size);
+    merge(e);
+    return;
+  }
+
+  if (size > stride_) setStride(size);
+  const size_t chunk_count = chunks_.size();
+  pushBack(chunks_, mono_time, dat, size);
+  if (chunks_.size() != chunk_count) {
+    chunk_times_.push_back(mono_time);
+    chunk_offsets_.push_back(size_);
+  }
+  ++size_;
+}
+
+void MessageEvents::merge(const MessageEvents &events) {
+  if (events.empty()) return;
+  if (events.stride_ > stride_) setStride(events.stride_);
+
+  // only the chunks overlapping the new events are rebuilt
+  const uint64_t first = events.front().mono_time;
+  const uint64_t last = events.back().mono_time;
+  auto lo = std::partition_point(chunks_.begin(), chunks_.end(), [=](auto &c) { return c.mono_times.back() <= first; });
+  if (lo == chunks_.end()) {
+    // the common case of a live stream: fill up the last chunk and extend the index
+    for (const CanEvent e : events) {
+      append(e.mono_time, e.dat, e.size);
+    }
+    return;
+  }
+  auto hi = std::partition_point(lo, chunks_.end(), [=](auto &c) { return c.mono_times.front() <= last; });
+
+  std::vector<Chunk> merged;
+  if (lo == hi && events.stride_ == stride_) {
+    merged = events.chunks_;
+  } else {
+    auto it = iterator(this, lo - chunks_.begin(), 0), it_end = iterator(this, hi - chunks_.begin(), 0);
+    auto new_it = events.begin(), new_end = events.end();
+    while (it != it_end || new_it != new_end) {
+      const CanEvent e = (new_it == new_end || (it != it_end && (*it).mono_time <= (*new_it).mono_time)) ? *it++ : *new_it++;
+      pushBack(merged, e.mono_time, e.dat, e.size);
+    }
+  }
+
+  auto pos = chunks_.erase(lo, hi);
+  chunks_.insert(pos, std::make_move_iterator(merged.begin()), std::make_move_iterator(merged.end()));
+  updateIndex();
+}
+
+void MessageEvents::pushBack(std::vector<Chunk> &chunks, uint64_t mono_time, const uint8_t *dat, uint8_t size) const {
+  if (chunks.empty() || chunks.back().mono_times.size() >= CHUNK_SIZE) {
+    chunks.emplace_back();
+  }
+  auto &c = chunks.back();
+  c.mono_times.push_back(mono_time);
+  c.sizes.push_back(size);
+  c.data.resize(c.data.size() + stride_);
+  std::copy_n(dat, size, c.data.end() - stride_);
+}
+
+void MessageEvents::setStride(uint8_t stride) {
+  for (auto &c : chunks_) {
+    std::vector<uint8_t> data(c.mono_times.size() * stride);
+    for (size_t i = 0; i < c.mono_times.size(); ++i) {
+      std::copy_n(c.data.begin() + i * stride_, c.sizes[i], data.begin() + i * stride);
     }
-    auto pos = std::upper_bound(all_events_.cbegin(), all_events_.cend(), events.front()->mono_time, CompareCanEvent());
-    all_events_.insert(pos, events.cbegin(), events.cend());
-    emit eventsMerged(msg_events);
+    c.data = std::move(data);
+  }
+  stride_ = stride;
+}
+
+void MessageEvents::updateIndex() {
+  chunk_times_.resize(chunks_.size());
+  chunk_offsets_.resize(chunks_.size());
+  size_ = 0;
+  for (size_t i = 0; i < chunks_.size(); ++i) {
+    chunk_times_[i] = chunks_[i].mono_times.front();
+    chunk_offsets_[i] = size_;
+    size_ += chunks_[i].mono_times.size();
   }
-  lastest_event_ts = all_events_.empty() ? 0 : all_events_.back()->mono_time;
 }
 
 // CanData
@@ -207,11 +317,11 @@ double calc_freq(const MessageId &msg_id, double current_sec) {
   const auto &events = can->events(msg_id);
   uint64_t cur_mono_time = (can->routeStartTime() + current_sec) * 1e9;
   uint64_t first_mono_time = std::max<int64_t>(0, cur_mono_time - 59 * 1e9);
-  auto first = std::lower_bound(events.begin(), events.end(), first_mono_time, CompareCanEvent());
-  auto second = std::lower_bound(first, events.end(), cur_mono_time, CompareCanEvent());
+  auto first = events.lowerBound(first_mono_time);
+  auto second = events.lowerBound(cur_mono_time);
   if (first != events.end() && second != events.end()) {
-    double duration = ((*second)->mono_time - (*first)->mono_time) / 1e9;
-    uint32_t count = std::distance(first, second);
+    double duration = (second->mono_time - first->mono_time) / 1e9;
+    uint32_t count = second.index() - first.index();
     return count / std::max(1.0, duration);
   }
   return 0;
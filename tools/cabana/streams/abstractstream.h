@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <iterator>
 #include <memory>
 #include <mutex>
 #include <set>
@@ -35,17 +36,85 @@ struct CanData {
   double last_freq_update_ts = 0;
 };
 
+// A CAN event read from MessageEvents, dat points into the store
 struct CanEvent {
-  uint8_t src;
-  uint32_t address;
   uint64_t mono_time;
   uint8_t size;
-  uint8_t dat[];
+  const uint8_t *dat;
 };
 
-struct CompareCanEvent {
-  constexpr bool operator()(const CanEvent *const e, uint64_t ts) const { return e->mono_time < ts; }
-  constexpr bool operator()(uint64_t ts, const CanEvent *const e) const { return ts < e->mono_time; }
+// Columnar store of the events of one message, sorted by time. Timestamps, sizes and payloads
+// are kept in contiguous arrays, payloads padded to the largest size seen. Events are appended in
+// chunks of up to CHUNK_SIZE, and the first timestamp of every chunk forms a sparse time index.
+class MessageEvents {
+  struct Chunk {
+    std::vector<uint64_t> mono_times;
+    std::vector<uint8_t> sizes;
+    std::vector<uint8_t> data;
+  };
+
+public:
+  static constexpr size_t CHUNK_SIZE = 4096;
+
+  class iterator {
+  public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = CanEvent;
+    using difference_type = std::ptrdiff_t;
+    using reference = CanEvent;
+    struct pointer {
+      CanEvent e;
+      const CanEvent *operator->() const { return &e; }
+    };
+
+    iterator() = default;
+    CanEvent operator*() const {
+      const Chunk &c = events->chunks_[chunk];
+      return {c.mono_times[offset], c.sizes[offset], c.data.data() + offset * events->stride_};
+    }
+    pointer operator->() const { return {**this}; }
+    iterator &operator++();
+    iterator &operator--();
+    iterator operator++(int) { iterator it = *this; ++*this; return it; }
+    iterator operator--(int) { iterator it = *this; --*this; return it; }
+    bool operator==(const iterator &other) const { return chunk == other.chunk && offset == other.offset; }
+    bool operator!=(const iterator &other) const { return !(*this == other); }
+    // position of the event in the message
+    size_t index() const { return chunk < events->chunk_offsets_.size() ? events->chunk_offsets_[chunk] + offset : events->size_; }
+
+  private:
+    iterator(const MessageEvents *e, size_t c, size_t o) : events(e), chunk(c), offset(o) {}
+    const MessageEvents *events = nullptr;
+    size_t chunk = 0;
+    size_t offset = 0;
+    friend class MessageEvents;
+  };
+
+  inline size_t size() const { return size_; }
+  inline bool empty() const { return size_ == 0; }
+  inline size_t chunkCount() const { return chunks_.size(); }
+  inline iterator begin() const { return {this, 0, 0}; }
+  inline iterator end() const { return {this, chunks_.size(), 0}; }
+  inline CanEvent front() const { return *begin(); }
+  inline CanEvent back() const { return *std::prev(end()); }
+  // first event at or after ts, and first event after ts
+  iterator lowerBound(uint64_t ts) const;
+  iterator upperBound(uint64_t ts) const;
+
+  void append(uint64_t mono_time, const uint8_t *dat, uint8_t size);
+  // merge sorted events, existing events go first on equal timestamps
+  void merge(const MessageEvents &events);
+
+private:
+  void pushBack(std::vector<Chunk> &chunks, uint64_t mono_time, const uint8_t *dat, uint8_t size) const;
+  void setStride(uint8_t stride);
+  void updateIndex();
+
+  std::vector<Chunk> chunks_;
+  std::vector<uint64_t> chunk_times_;
+  std::vector<size_t> chunk_offsets_;
+  size_t size_ = 0;
+  uint8_t stride_ = 0;
 };
 
 struct BusConfig {
@@ -54,7 +123,7 @@ struct BusConfig {
   bool can_fd = false;
 };
 
-typedef std::unordered_map<MessageId, std::vector<const CanEvent *>> MessageEventsMap;
+typedef std::unordered_map<MessageId, MessageEvents> MessageEventsMap;
 
 class AbstractStream : public QObject {
   Q_OBJECT
@@ -78,9 +147,8 @@ public:
 
   inline const std::unordered_map<MessageId, CanData> &lastMessages() const { return last_msgs; }
   inline const MessageEventsMap &eventsMap() const { return events_; }
-  inline const std::vector<const CanEvent *> &allEvents() const { return all_events_; }
   const CanData &lastMessage(const MessageId &id);
-  const std::vector<const CanEvent *> &events(const MessageId &id) const;
+  const MessageEvents &events(const MessageId &id) const;
 
   size_t suppressHighlighted();
   void clearSuppressed();
@@ -100,12 +168,12 @@ public:
   SourceSet sources;
 
 protected:
-  void mergeEvents(const std::vector<const CanEvent *> &events);
-  const CanEvent *newEvent(uint64_t mono_time, const cereal::CanData::Reader &c);
+  void mergeEvents(const MessageEventsMap &events);
+  static void addEvent(MessageEventsMap &events, uint64_t mono_time, const cereal::CanData::Reader &c);
   void updateEvent(const MessageId &id, double sec, const uint8_t *data, uint8_t size);
+  uint64_t firstEventMonoTime() const { return first_event_ts_; }
   uint64_t lastEventMonoTime() const { return lastest_event_ts; }
 
-  std::vector<const CanEvent *> all_events_;
   uint64_t lastest_event_ts = 0;
 
 private:
@@ -116,7 +184,7 @@ private:
   double current_sec_ = 0;
   MessageEventsMap events_;
   std::unordered_map<MessageId, CanData> last_msgs;
-  std::unique_ptr<MonotonicBuffer> event_buffer_;
+  uint64_t first_event_ts_ = 0;
 
   // Members accessed in multiple threads. (mutex protected)
   std::mutex mutex_;
@@ -74,7 +74,7 @@ void LiveStream::handleEvent(kj::ArrayPtr<capnp::word> data) {
     const uint64_t mono_time = event.getLogMonoTime();
     std::lock_guard lk(lock);
     for (const auto &c : event.getCan()) {
-      received_events_.push_back(newEvent(mono_time, c));
+      addEvent(received_events_, mono_time, c);
     }
   }
 }
@@ -87,8 +87,8 @@ void LiveStream::timerEvent(QTimerEvent *event) {
       mergeEvents(received_events_);
       received_events_.clear();
     }
-    if (!all_events_.empty()) {
-      begin_event_ts = all_events_.front()->mono_time;
+    if (!eventsMap().empty()) {
+      begin_event_ts = firstEventMonoTime();
       updateEvents();
       return;
     }
@@ -101,7 +101,7 @@ void LiveStream::updateEvents() {
 
   if (first_update_ts == 0) {
     first_update_ts = nanos_since_boot();
-    first_event_ts = current_event_ts = all_events_.back()->mono_time;
+    first_event_ts = current_event_ts = lastEventMonoTime();
   }
 
   if (paused_ || prev_speed != speed_) {
@@ -112,17 +112,18 @@ void LiveStream::updateEvents() {
   }
 
   uint64_t last_ts = post_last_event && speed_ == 1.0
-                       ? all_events_.back()->mono_time
+                       ? lastEventMonoTime()
                        : first_event_ts + (nanos_since_boot() - first_update_ts) * speed_;
-  auto first = std::upper_bound(all_events_.cbegin(), all_events_.cend(), current_event_ts, CompareCanEvent());
-  auto last = std::upper_bound(first, all_events_.cend(), last_ts, CompareCanEvent());
-
-  for (auto it = first; it != last; ++it) {
-    const CanEvent *e = *it;
-    MessageId id = {.source = e->src, .address = e->address};
-    updateEvent(id, (e->mono_time - begin_event_ts) / 1e9, e->dat, e->size);
-    current_event_ts = e->mono_time;
+  uint64_t updated_ts = current_event_ts;
+  for (const auto &[id, events] : eventsMap()) {
+    auto last = events.upperBound(last_ts);
+    for (auto it = events.upperBound(current_event_ts); it != last; ++it) {
+      const CanEvent e = *it;
+      updateEvent(id, (e.mono_time - begin_event_ts) / 1e9, e.dat, e.size);
+      updated_ts = std::max(updated_ts, e.mono_time);
+    }
   }
+  current_event_ts = updated_ts;
   emit privateUpdateLastMsgsSignal();
 }
 
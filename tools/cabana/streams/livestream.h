@@ -33,7 +33,7 @@ private:
 
   std::mutex lock;
   QThread *stream_thread;
-  std::vector<const CanEvent *> received_events_;
+  MessageEventsMap received_events_;
 
   int timer_id;
   QBasicTimer update_timer;
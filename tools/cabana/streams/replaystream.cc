@@ -29,13 +29,13 @@ void ReplayStream::mergeSegments() {
     if (seg && seg->isLoaded() && !processed_segments.count(n)) {
       processed_segments.insert(n);
 
-      std::vector<const CanEvent *> new_events;
-      new_events.reserve(seg->log->events.size());
+      MessageEventsMap new_events;
       for (auto it = seg->log->events.cbegin(); it != seg->log->events.cend(); ++it) {
         if ((*it)->which == cereal::Event::Which::CAN) {
           const uint64_t ts = (*it)->mono_time;
-          for (const auto &c : (*it)->event.getCan()) {
-            new_events.push_back(newEvent(ts, c));
+          capnp::FlatArrayMessageReader reader((*it)->words);
+          for (const auto &c : reader.getRoot<cereal::Event>().getCan()) {
+            addEvent(new_events, ts, c);
           }
         }
       }
@@ -64,7 +64,8 @@ bool ReplayStream::eventFilter(const Event *event) {
   static double prev_update_ts = 0;
   if (event->which == cereal::Event::Which::CAN) {
     double current_sec = event->mono_time / 1e9 - routeStartTime();
-    for (const auto &c : event->event.getCan()) {
+    capnp::FlatArrayMessageReader reader(event->words);
+    for (const auto &c : reader.getRoot<cereal::Event>().getCan()) {
       MessageId id = {.source = c.getSrc(), .address = c.getAddress()};
       const auto dat = c.getDat();
       updateEvent(id, current_sec, (const uint8_t*)dat.begin(), dat.size());
@@ -85,3 +85,58 @@ CM_ SG_ 160 signal_2 "multiple line comment
   REQUIRE(msg->sigs[1]->size == 1);
   REQUIRE(msg->sigs[1]->receiver_name == "XXX");
 }
+
+TEST_CASE("MessageEvents") {
+  MessageEvents events;
+  const uint8_t dat[] = {1, 2, 3, 4, 5, 6, 7, 8};
+  // two batches spanning several chunks, the second overlaps the first and has longer payloads
+  MessageEvents batch_1, batch_2;
+  const uint64_t count = MessageEvents::CHUNK_SIZE * 2;
+  for (uint64_t i = 0; i < count; ++i) {
+    batch_1.append(i * 2, dat, 4);
+    batch_2.append(i * 2 + 1, dat, 8);
+  }
+  events.merge(batch_2);
+  events.merge(batch_1);
+
+  REQUIRE(events.size() == count * 2);
+  uint64_t ts = 0;
+  for (const CanEvent e : events) {
+    REQUIRE(e.mono_time == ts);
+    REQUIRE(e.size == (ts % 2 ? 8 : 4));
+    REQUIRE(std::equal(e.dat, e.dat + e.size, dat));
+    ++ts;
+  }
+
+  REQUIRE(events.lowerBound(100).index() == 100);
+  REQUIRE(events.upperBound(100).index() == 101);
+  REQUIRE(events.lowerBound(count * 2) == events.end());
+  REQUIRE(std::prev(events.upperBound(MessageEvents::CHUNK_SIZE))->mono_time == MessageEvents::CHUNK_SIZE);
+}
+
+TEST_CASE("MessageEvents append batches") {
+  // a live stream merges a few events per update, they fill up the last chunk
+  MessageEvents events;
+  const uint8_t dat[] = {1, 2, 3, 4, 5, 6, 7, 8};
+  const size_t batches = 20000, batch_size = 10;
+  uint64_t ts = 0;
+  for (size_t i = 0; i < batches; ++i) {
+    MessageEvents batch;
+    for (size_t j = 0; j < batch_size; ++j) {
+      batch.append(ts++, dat, (i % 2) ? 8 : 4);
+    }
+    events.merge(batch);
+  }
+
+  const size_t total = batches * batch_size;
+  REQUIRE(events.size() == total);
+  REQUIRE(events.chunkCount() == (total + MessageEvents::CHUNK_SIZE - 1) / MessageEvents::CHUNK_SIZE);
+  ts = 0;
+  for (const CanEvent e : events) {
+    REQUIRE(e.mono_time == ts);
+    REQUIRE(e.size == ((ts / batch_size) % 2 ? 8 : 4));
+    ++ts;
+  }
+  REQUIRE(events.lowerBound(MessageEvents::CHUNK_SIZE + 5).index() == MessageEvents::CHUNK_SIZE + 5);
+  REQUIRE(events.upperBound(total - 2).index() == total - 1);
+}
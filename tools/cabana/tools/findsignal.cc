@@ -37,18 +37,18 @@ void FindSignalModel::search(std::function<bool(double)> cmp) {
   filtered_signals.reserve(prev_sigs.size());
   QtConcurrent::blockingMap(prev_sigs, [&](auto &s) {
     const auto &events = can->events(s.id);
-    auto first = std::upper_bound(events.cbegin(), events.cend(), s.mono_time, CompareCanEvent());
-    auto last = events.cend();
+    auto first = events.upperBound(s.mono_time);
+    auto last = events.end();
     if (last_time < std::numeric_limits<uint64_t>::max()) {
-      last = std::upper_bound(events.cbegin(), events.cend(), last_time, CompareCanEvent());
+      last = events.upperBound(last_time);
     }
 
-    auto it = std::find_if(first, last, [&](const CanEvent *e) { return cmp(get_raw_value(e->dat, e->size, s.sig)); });
+    auto it = std::find_if(first, last, [&](const CanEvent &e) { return cmp(get_raw_value(e.dat, e.size, s.sig)); });
     if (it != last) {
       auto values = s.values;
-      values += QString("(%1, %2)").arg((*it)->mono_time / 1e9 - can->routeStartTime(), 0, 'f', 2).arg(get_raw_value((*it)->dat, (*it)->size, s.sig));
+      values += QString("(%1, %2)").arg(it->mono_time / 1e9 - can->routeStartTime(), 0, 'f', 2).arg(get_raw_value(it->dat, it->size, s.sig));
       std::lock_guard lk(lock);
-      filtered_signals.push_back({.id = s.id, .mono_time = (*it)->mono_time, .sig = s.sig, .values = values});
+      filtered_signals.push_back({.id = s.id, .mono_time = it->mono_time, .sig = s.sig, .values = values});
     }
   });
   histories.push_back(filtered_signals);
@@ -227,8 +227,8 @@ void FindSignalDlg::setInitialSignals() {
   for (const auto &[id, m] : can->lastMessages()) {
     if (buses.isEmpty() || buses.contains(id.source) && (addresses.isEmpty() || addresses.contains(id.address))) {
       const auto &events = can->events(id);
-      auto e = std::lower_bound(events.cbegin(), events.cend(), first_time, CompareCanEvent());
-      if (e != events.cend()) {
+      auto e = events.lowerBound(first_time);
+      if (e != events.end()) {
         const int total_size = m.dat.size() * 8;
         for (int size = min_size->value(); size <= max_size->value(); ++size) {
           for (int start = 0; start <= total_size - size; ++start) {
@@ -236,7 +236,7 @@ void FindSignalDlg::setInitialSignals() {
             s.sig.start_bit = start;
             s.sig.size = size;
             updateMsbLsb(s.sig);
-            s.value = get_raw_value((*e)->dat, (*e)->size, s.sig);
+            s.value = get_raw_value(e->dat, e->size, s.sig);
             model->initial_signals.push_back(s);
           }
         }
@@ -118,25 +118,29 @@ QList<FindSimilarBitsDlg::mismatched_struct> FindSimilarBitsDlg::calcBits(uint8_
                                                                           int bit_idx, uint8_t find_bus, bool equal, int min_msgs_cnt) {
   QHash<uint32_t, QVector<uint32_t>> mismatches;
   QHash<uint32_t, uint32_t> msg_count;
-  const auto &events = can->allEvents();
-  int bit_to_find = -1;
-  for (const CanEvent *e : events) {
-    if (e->src == bus) {
-      if (e->address == selected_address && e->size > byte_idx) {
-        bit_to_find = ((e->dat[byte_idx] >> (7 - bit_idx)) & 1) != 0;
+  const auto &selected_events = can->events({.source = bus, .address = selected_address});
+  for (const auto &[id, events] : can->eventsMap()) {
+    if (id.source != find_bus) continue;
+
+    msg_count[id.address] += events.size();
+    // compare against the latest selected message at the time of each event
+    auto selected = selected_events.begin();
+    int bit_to_find = -1;
+    for (const CanEvent e : events) {
+      for (; selected != selected_events.end() && selected->mono_time <= e.mono_time; ++selected) {
+        if (selected->size > byte_idx) {
+          bit_to_find = ((selected->dat[byte_idx] >> (7 - bit_idx)) & 1) != 0;
+        }
       }
-    }
-    if (e->src == find_bus) {
-      ++msg_count[e->address];
       if (bit_to_find == -1) continue;
 
-      auto &mismatched = mismatches[e->address];
-      if (mismatched.size() < e->size * 8) {
-        mismatched.resize(e->size * 8);
+      auto &mismatched = mismatches[id.address];
+      if (mismatched.size() < e.size * 8) {
+        mismatched.resize(e.size * 8);
       }
-      for (int i = 0; i < e->size; ++i) {
+      for (int i = 0; i < e.size; ++i) {
         for (int j = 0; j < 8; ++j) {
-          int bit = ((e->dat[i] >> (7 - j)) & 1) != 0;
+          int bit = ((e.dat[i] >> (7 - j)) & 1) != 0;
           mismatched[i * 8 + j] += equal ? (bit != bit_to_find) : (bit == bit_to_find);
         }
       }
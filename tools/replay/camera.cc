@@ -1,6 +1,8 @@
 #include "tools/replay/camera.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <tuple>
 
 #include "third_party/linux/include/msm_media_info.h"
@@ -40,6 +42,7 @@ void CameraServer::startVipcServer() {
       auto [nv12_width, nv12_height, nv12_buffer_size] = get_nv12_info(cam.width, cam.height);
       vipc_server_->create_buffers_with_sizes(cam.stream_type, YUV_BUFFER_COUNT, false, cam.width, cam.height,
                                               nv12_buffer_size, nv12_width, nv12_width * nv12_height);
+      cam.cache = std::make_unique<FrameCache>(cam.width, cam.height);
       if (!cam.thread.joinable()) {
         cam.thread = std::thread(&CameraServer::cameraThread, this, std::ref(cam));
       }
@@ -49,41 +52,31 @@ void CameraServer::startVipcServer() {
 }
 
 void CameraServer::cameraThread(Camera &cam) {
-  auto read_frame = [&](FrameReader *fr, int frame_id) {
-    VisionBuf *yuv_buf = vipc_server_->get_buffer(cam.stream_type);
-    assert(yuv_buf);
-    bool ret = fr->get(frame_id, yuv_buf);
-    return ret ? yuv_buf : nullptr;
-  };
-
   while (true) {
-    const auto [fr, eidx] = cam.queue.pop();
-    if (!fr) break;
+    const auto frame = cam.queue.pop();
+    if (!frame.fr) break;
 
-    const int id = eidx.getSegmentId();
-    bool prefetched = (id == cam.cached_id && eidx.getSegmentNum() == cam.cached_seg);
-    auto yuv = prefetched ? cam.cached_buf : read_frame(fr, id);
-    if (yuv) {
+    VisionBuf *decoded = cam.cache->get(frame.fr, frame.id);
+    if (decoded) {
+      VisionBuf *yuv = vipc_server_->get_buffer(cam.stream_type);
+      assert(yuv && yuv->len >= decoded->len);
+      memcpy(yuv->addr, decoded->addr, decoded->len);
       VisionIpcBufExtra extra = {
-          .frame_id = eidx.getFrameId(),
-          .timestamp_sof = eidx.getTimestampSof(),
-          .timestamp_eof = eidx.getTimestampEof(),
+          .frame_id = frame.frame_id,
+          .timestamp_sof = frame.timestamp_sof,
+          .timestamp_eof = frame.timestamp_eof,
       };
-      yuv->set_frame_id(eidx.getFrameId());
+      yuv->set_frame_id(frame.frame_id);
       vipc_server_->send(yuv, &extra);
     } else {
-      rError("camera[%d] failed to get frame: %lu", cam.type, eidx.getSegmentId());
+      rError("camera[%d] failed to get frame: %d", cam.type, frame.id);
     }
 
-    cam.cached_id = id + 1;
-    cam.cached_seg = eidx.getSegmentNum();
-    cam.cached_buf = read_frame(fr, cam.cached_id);
-
     --publishing_;
   }
 }
 
-void CameraServer::pushFrame(CameraType type, FrameReader *fr, const cereal::EncodeIndex::Reader &eidx) {
+void CameraServer::pushFrame(CameraType type, const std::shared_ptr<FrameReader> &fr, const cereal::EncodeIndex::Reader &eidx) {
   auto &cam = cameras_[type];
   if (cam.width != fr->width || cam.height != fr->height) {
     cam.width = fr->width;
@@ -93,7 +86,7 @@ void CameraServer::pushFrame(CameraType type, FrameReader *fr, const cereal::Enc
   }
 
   ++publishing_;
-  cam.queue.push({fr, eidx});
+  cam.queue.push({fr, (int)eidx.getSegmentId(), eidx.getFrameId(), eidx.getTimestampSof(), eidx.getTimestampEof()});
 }
 
 void CameraServer::waitForSent() {
@@ -101,3 +94,102 @@ void CameraServer::waitForSent() {
     std::this_thread::yield();
   }
 }
+
+// class FrameCache
+
+FrameCache::FrameCache(int width, int height, int size) : slots_(size) {
+  auto [nv12_width, nv12_height, nv12_buffer_size] = get_nv12_info(width, height);
+  for (auto &slot : slots_) {
+    slot.buf.allocate(nv12_buffer_size);
+    slot.buf.init_yuv(width, height, nv12_width, nv12_width * nv12_height);
+  }
+  thread_ = std::thread(&FrameCache::decodeThread, this);
+}
+
+FrameCache::~FrameCache() {
+  {
+    std::lock_guard lk(lock_);
+    exit_ = true;
+  }
+  cv_.notify_all();
+  thread_.join();
+  for (auto &slot : slots_) {
+    slot.buf.free();
+  }
+}
+
+VisionBuf *FrameCache::get(const std::shared_ptr<FrameReader> &fr, int id) {
+  std::unique_lock lk(lock_);
+  backward_ = fr == target_fr_ && id < target_id_;
+  target_fr_ = fr;
+  target_id_ = id;
+  cv_.notify_all();
+
+  Slot *slot = nullptr;
+  cv_.wait(lk, [&]() {
+    slot = find(fr.get(), id);
+    return exit_ || (slot && (slot->decoded || slot->failed));
+  });
+  return slot && slot->decoded ? &slot->buf : nullptr;
+}
+
+FrameCache::Slot *FrameCache::find(const FrameReader *fr, int id) {
+  auto it = std::find_if(slots_.begin(), slots_.end(), [=](auto &s) { return s.fr.get() == fr && s.id == id; });
+  return it != slots_.end() ? &(*it) : nullptr;
+}
+
+// the first missing frame in the window around the target, and a slot outside of the window to decode it into.
+// the target's slot is always in the window, so the buffer returned by get() is not overwritten.
+bool FrameCache::nextFrame(std::shared_ptr<FrameReader> &fr, int &id, Slot *&slot) {
+  if (!target_fr_) return false;
+
+  const int count = target_fr_->getFrameCount();
+  const int size = slots_.size();
+  int lo = target_id_, hi = target_id_;
+  if (target_id_ >= 0 && target_id_ < count) {
+    if (backward_) {
+      lo = std::max(target_fr_->keyFrameIndex(target_id_), target_id_ - size + 1);
+    } else {
+      hi = std::min(target_id_ + size, count) - 1;
+    }
+  }
+
+  for (int i = lo; i <= hi; ++i) {
+    if (find(target_fr_.get(), i)) continue;
+
+    auto it = std::find_if(slots_.begin(), slots_.end(), [&](auto &s) {
+      return s.id < 0 || s.fr != target_fr_ || s.id < lo || s.id > hi;
+    });
+    if (it == slots_.end()) return false;
+
+    fr = target_fr_;
+    id = i;
+    slot = &(*it);
+    return true;
+  }
+  return false;
+}
+
+void FrameCache::decodeThread() {
+  std::unique_lock lk(lock_);
+  while (true) {
+    std::shared_ptr<FrameReader> fr;
+    int id = -1;
+    Slot *slot = nullptr;
+    cv_.wait(lk, [&]() { return exit_ || nextFrame(fr, id, slot); });
+    if (exit_) break;
+
+    slot->fr = fr;
+    slot->id = id;
+    slot->decoded = slot->failed = false;
+
+    // frames are decoded in ascending order, so FrameReader only seeks to a key frame when the target jumps
+    lk.unlock();
+    bool ret = fr->get(id, &slot->buf);
+    lk.lock();
+
+    slot->decoded = ret;
+    slot->failed = !ret;
+    cv_.notify_all();
+  }
+}
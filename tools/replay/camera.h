@@ -2,9 +2,13 @@
 
 #include <unistd.h>
 
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <tuple>
 #include <utility>
+#include <vector>
 
 #include "cereal/visionipc/visionipc_server.h"
 #include "common/queue.h"
@@ -13,24 +17,63 @@
 
 std::tuple<size_t, size_t, size_t> get_nv12_info(int width, int height);
 
+const int DECODE_AHEAD_FRAMES = 8;
+
+// Decodes the frames following the last requested one on its own thread, into a bounded ring of NV12 buffers.
+// Going backwards, the frames from the GOP's key frame up to the requested one are kept, so a GOP is decoded once
+// instead of once per frame.
+class FrameCache {
+public:
+  FrameCache(int width, int height, int size = DECODE_AHEAD_FRAMES);
+  ~FrameCache();
+  // waits for frame id to be decoded. the buffer stays valid until the next call, nullptr if decoding failed.
+  VisionBuf *get(const std::shared_ptr<FrameReader> &fr, int id);
+
+protected:
+  struct Slot {
+    std::shared_ptr<FrameReader> fr;
+    int id = -1;
+    bool decoded = false;
+    bool failed = false;
+    VisionBuf buf;
+  };
+  Slot *find(const FrameReader *fr, int id);
+  bool nextFrame(std::shared_ptr<FrameReader> &fr, int &id, Slot *&slot);
+  void decodeThread();
+
+  std::mutex lock_;
+  std::condition_variable cv_;
+  std::vector<Slot> slots_;
+  std::shared_ptr<FrameReader> target_fr_;
+  int target_id_ = -1;
+  bool backward_ = false;
+  bool exit_ = false;
+  std::thread thread_;
+};
+
 class CameraServer {
 public:
   CameraServer(std::pair<int, int> camera_size[MAX_CAMERAS] = nullptr);
   ~CameraServer();
-  void pushFrame(CameraType type, FrameReader* fr, const cereal::EncodeIndex::Reader& eidx);
+  void pushFrame(CameraType type, const std::shared_ptr<FrameReader> &fr, const cereal::EncodeIndex::Reader &eidx);
   void waitForSent();
 
 protected:
+  struct Frame {
+    std::shared_ptr<FrameReader> fr;
+    int id;
+    uint32_t frame_id;
+    uint64_t timestamp_sof;
+    uint64_t timestamp_eof;
+  };
   struct Camera {
     CameraType type;
     VisionStreamType stream_type;
     int width;
     int height;
     std::thread thread;
-    SafeQueue<std::pair<FrameReader*, const cereal::EncodeIndex::Reader>> queue;
-    int cached_id = -1;
-    int cached_seg = -1;
-    VisionBuf * cached_buf;
+    SafeQueue<Frame> queue;
+    std::unique_ptr<FrameCache> cache;
   };
   void startVipcServer();
   void cameraThread(Camera &cam);
@@ -139,9 +139,10 @@ bool FrameReader::load(const std::byte *data, size_t size, bool no_hw_decoder, s
       valid_ = (ret == AVERROR_EOF);
       break;
     }
+    if (pkt->flags & AV_PKT_FLAG_KEY) {
+      key_frames_.push_back(packets.size());
+    }
     packets.push_back(pkt);
-    // some stream seems to contain no keyframes
-    key_frames_count_ += pkt->flags & AV_PKT_FLAG_KEY;
   }
   valid_ = valid_ && !packets.empty();
   return valid_;
@@ -183,16 +184,18 @@ bool FrameReader::get(int idx, VisionBuf *buf) {
   return decode(idx, buf);
 }
 
+int FrameReader::keyFrameIndex(int idx) const {
+  auto it = std::upper_bound(key_frames_.begin(), key_frames_.end(), idx);
+  return it == key_frames_.begin() ? 0 : *std::prev(it);
+}
+
 bool FrameReader::decode(int idx, VisionBuf *buf) {
   int from_idx = idx;
-  if (idx != prev_idx + 1 && key_frames_count_ > 1) {
-    // seeking to the nearest key frame
-    for (int i = idx; i >= 0; --i) {
-      if (packets[i]->flags & AV_PKT_FLAG_KEY) {
-        from_idx = i;
-        break;
-      }
-    }
+  // some stream seems to contain no keyframes
+  if (idx != prev_idx + 1 && key_frames_.size() > 1) {
+    int key_frame = keyFrameIndex(idx);
+    // skipping ahead within the current GOP continues from the last decoded frame, otherwise seek to the key frame
+    from_idx = (idx > prev_idx && key_frame <= prev_idx) ? prev_idx + 1 : key_frame;
   }
   prev_idx = idx;
 
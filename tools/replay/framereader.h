@@ -26,6 +26,8 @@ public:
   bool get(int idx, VisionBuf *buf);
   int getYUVSize() const { return width * height * 3 / 2; }
   size_t getFrameCount() const { return packets.size(); }
+  // index of the key frame that starts the GOP of frame idx
+  int keyFrameIndex(int idx) const;
   bool valid() const { return valid_; }
 
   int width = 0, height = 0;
@@ -40,7 +42,7 @@ private:
   std::unique_ptr<AVFrame, AVFrameDeleter>av_frame_, hw_frame;
   AVFormatContext *input_ctx = nullptr;
   AVCodecContext *decoder_ctx = nullptr;
-  int key_frames_count_ = 0;
+  std::vector<int> key_frames_;  // GOP index, built at load time
   bool valid_ = false;
   AVIOContext *avio_ctx_ = nullptr;
 
@@ -1,33 +1,17 @@
 #include "tools/replay/logreader.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <algorithm>
 #include "tools/replay/filereader.h"
 #include "tools/replay/util.h"
 
-Event::Event(const kj::ArrayPtr<const capnp::word> &amsg, bool frame) : reader(amsg), frame(frame) {
-  words = kj::ArrayPtr<const capnp::word>(amsg.begin(), reader.getEnd());
-  event = reader.getRoot<cereal::Event>();
-  which = event.which();
-  mono_time = event.getLogMonoTime();
-
-  // 1) Send video data at t=timestampEof/timestampSof
-  // 2) Send encodeIndex packet at t=logMonoTime
-  if (frame) {
-    auto idx = capnp::AnyStruct::Reader(event).getPointerSection()[0].getAs<cereal::EncodeIndex>();
-    // C2 only has eof set, and some older routes have neither
-    uint64_t sof = idx.getTimestampSof();
-    uint64_t eof = idx.getTimestampEof();
-    if (sof > 0) {
-      mono_time = sof;
-    } else if (eof > 0) {
-      mono_time = eof;
-    }
-  }
-}
-
 // class LogReader
 
-LogReader::LogReader(size_t memory_pool_block_size) {
+LogReader::LogReader(const std::vector<bool> &filters, size_t memory_pool_block_size) : filters_(filters) {
 #ifdef HAS_MEMORY_RESOURCE
   const size_t buf_size = sizeof(Event) * memory_pool_block_size;
   mbr_ = std::make_unique<std::pmr::monotonic_buffer_resource>(buf_size);
@@ -39,49 +23,99 @@ LogReader::~LogReader() {
   for (Event *e : events) {
     delete e;
   }
+  if (mmap_) {
+    munmap(mmap_, mmap_size_);
+  }
 }
 
 bool LogReader::load(const std::string &url, std::atomic<bool> *abort, bool local_cache, int chunk_size, int retries) {
-  raw_ = FileReader(local_cache, chunk_size, retries).read(url, abort);
-  if (raw_.empty()) return false;
+  const bool compressed = url.find(".bz2") != std::string::npos;
+  const bool is_remote = url.find("https://") == 0;
+  if ((!is_remote || local_cache) && mapFile(is_remote ? cacheFilePath(url) : url)) {
+    if (!compressed) return parse(abort);
 
-  if (url.find(".bz2") != std::string::npos) {
-    raw_ = decompressBZ2(raw_, abort);
+    // decompress straight from the mapping, the compressed data is no longer needed afterwards
+    raw_ = decompressBZ2((const std::byte *)mmap_, mmap_size_, abort);
+    munmap(mmap_, mmap_size_);
+    mmap_ = nullptr;
+  } else {
+    raw_ = FileReader(local_cache, chunk_size, retries).read(url, abort);
     if (raw_.empty()) return false;
+
+    if (compressed) {
+      raw_ = decompressBZ2(raw_, abort);
+    }
   }
+  if (raw_.empty()) return false;
+
+  data_ = kj::ArrayPtr<const capnp::word>((const capnp::word *)raw_.data(), raw_.size() / sizeof(capnp::word));
   return parse(abort);
 }
 
 bool LogReader::load(const std::byte *data, size_t size, std::atomic<bool> *abort) {
   raw_.assign((const char *)data, size);
+  data_ = kj::ArrayPtr<const capnp::word>((const capnp::word *)raw_.data(), raw_.size() / sizeof(capnp::word));
   return parse(abort);
 }
 
-bool LogReader::parse(std::atomic<bool> *abort) {
-  try {
-    kj::ArrayPtr<const capnp::word> words((const capnp::word *)raw_.data(), raw_.size() / sizeof(capnp::word));
-    while (words.size() > 0 && !(abort && *abort)) {
-#ifdef HAS_MEMORY_RESOURCE
-      Event *evt = new (mbr_.get()) Event(words);
-#else
-      Event *evt = new Event(words);
-#endif
-      // Add encodeIdx packet again as a frame packet for the video stream
-      if (evt->which == cereal::Event::ROAD_ENCODE_IDX ||
-          evt->which == cereal::Event::DRIVER_ENCODE_IDX ||
-          evt->which == cereal::Event::WIDE_ROAD_ENCODE_IDX) {
+bool LogReader::mapFile(const std::string &file) {
+  int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return false;
+
+  struct stat st = {};
+  void *mem = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    mem = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (mem == MAP_FAILED) return false;
+
+  // the log is decompressed or indexed front to back in one pass
+  madvise(mem, st.st_size, MADV_SEQUENTIAL);
+  mmap_ = mem;
+  mmap_size_ = st.st_size;
+  data_ = kj::ArrayPtr<const capnp::word>((const capnp::word *)mem, mmap_size_ / sizeof(capnp::word));
+  return true;
+}
 
+Event *LogReader::newEvent(cereal::Event::Which which, uint64_t mono_time, const kj::ArrayPtr<const capnp::word> &words, bool frame) {
 #ifdef HAS_MEMORY_RESOURCE
-        Event *frame_evt = new (mbr_.get()) Event(words, true);
+  return new (mbr_.get()) Event(which, mono_time, words, frame);
 #else
-        Event *frame_evt = new Event(words, true);
+  return new Event(which, mono_time, words, frame);
 #endif
+}
 
-        events.push_back(frame_evt);
+bool LogReader::parse(std::atomic<bool> *abort) {
+  try {
+    kj::ArrayPtr<const capnp::word> words = data_;
+    while (words.size() > 0 && !(abort && *abort)) {
+      capnp::FlatArrayMessageReader reader(words);
+      auto event = reader.getRoot<cereal::Event>();
+      auto which = event.which();
+      auto msg = kj::arrayPtr(words.begin(), reader.getEnd());
+      words = kj::arrayPtr(reader.getEnd(), words.end());
+
+      if (!filters_.empty() && (which >= filters_.size() || !filters_[which])) {
+        continue;
       }
 
-      words = kj::arrayPtr(evt->reader.getEnd(), words.end());
-      events.push_back(evt);
+      uint64_t mono_time = event.getLogMonoTime();
+      events.push_back(newEvent(which, mono_time, msg));
+
+      // Add encodeIdx packet again as a frame packet for the video stream
+      // 1) Send video data at t=timestampEof/timestampSof
+      // 2) Send encodeIndex packet at t=logMonoTime
+      if (which == cereal::Event::ROAD_ENCODE_IDX ||
+          which == cereal::Event::DRIVER_ENCODE_IDX ||
+          which == cereal::Event::WIDE_ROAD_ENCODE_IDX) {
+        auto idx = capnp::AnyStruct::Reader(event).getPointerSection()[0].getAs<cereal::EncodeIndex>();
+        // C2 only has eof set, and some older routes have neither
+        uint64_t sof = idx.getTimestampSof();
+        uint64_t eof = idx.getTimestampEof();
+        uint64_t frame_time = sof > 0 ? sof : (eof > 0 ? eof : mono_time);
+        events.push_back(newEvent(which, frame_time, msg, true));
+      }
     }
   } catch (const kj::Exception &e) {
     rWarning("failed to parse log : %s", e.getDescription().cStr());
@@ -16,14 +16,12 @@ const CameraType ALL_CAMERAS[] = {RoadCam, DriverCam, WideRoadCam};
 const int MAX_CAMERAS = std::size(ALL_CAMERAS);
 const int DEFAULT_EVENT_MEMORY_POOL_BLOCK_SIZE = 65000;
 
+// Events are a compact index into the log: the message is decoded on access,
+// with capnp::FlatArrayMessageReader reader(e->words); reader.getRoot<cereal::Event>()
 class Event {
 public:
-  Event(cereal::Event::Which which, uint64_t mono_time) : reader(kj::ArrayPtr<capnp::word>{}) {
-    // construct a dummy Event for binary search, e.g std::upper_bound
-    this->which = which;
-    this->mono_time = mono_time;
-  }
-  Event(const kj::ArrayPtr<const capnp::word> &amsg, bool frame = false);
+  Event(cereal::Event::Which which, uint64_t mono_time, const kj::ArrayPtr<const capnp::word> &words = {}, bool frame = false)
+      : mono_time(mono_time), which(which), words(words), frame(frame) {}
   inline kj::ArrayPtr<const capnp::byte> bytes() const { return words.asBytes(); }
 
   struct lessThan {
@@ -43,15 +41,14 @@ public:
 
   uint64_t mono_time;
   cereal::Event::Which which;
-  cereal::Event::Reader event;
-  capnp::FlatArrayMessageReader reader;
   kj::ArrayPtr<const capnp::word> words;
   bool frame;
 };
 
 class LogReader {
 public:
-  LogReader(size_t memory_pool_block_size = DEFAULT_EVENT_MEMORY_POOL_BLOCK_SIZE);
+  // filters is indexed by cereal::Event::Which, only the services set to true are indexed. empty means all.
+  LogReader(const std::vector<bool> &filters = {}, size_t memory_pool_block_size = DEFAULT_EVENT_MEMORY_POOL_BLOCK_SIZE);
   ~LogReader();
   bool load(const std::string &url, std::atomic<bool> *abort = nullptr,
             bool local_cache = false, int chunk_size = -1, int retries = 0);
@@ -59,8 +56,16 @@ public:
   std::vector<Event*> events;
 
 private:
+  bool mapFile(const std::string &file);
   bool parse(std::atomic<bool> *abort);
+  Event *newEvent(cereal::Event::Which which, uint64_t mono_time, const kj::ArrayPtr<const capnp::word> &words, bool frame = false);
+
+  std::vector<bool> filters_;
+  // the decompressed log, or a read-only mapping of an uncompressed log file
   std::string raw_;
+  void *mmap_ = nullptr;
+  size_t mmap_size_ = 0;
+  kj::ArrayPtr<const capnp::word> data_;
 #ifdef HAS_MEMORY_RESOURCE
   std::unique_ptr<std::pmr::monotonic_buffer_resource> mbr_;
 #endif
@@ -1,5 +1,7 @@
 #include "tools/replay/replay.h"
 
+#include <cmath>
+
 #include <QDebug>
 #include <QtConcurrent>
 
@@ -32,9 +34,13 @@ Replay::Replay(QString route, QStringList allow, QStringList block, SubMaster *s
   if (sm == nullptr) {
     pm = std::make_unique<PubMaster>(s);
   }
+  // only index the services to be published, initData and carParams are needed to start the stream
+  filters_.resize(sockets_.size());
+  for (int i = 0; i < sockets_.size(); ++i) {
+    filters_[i] = sockets_[i] != nullptr || i == cereal::Event::Which::INIT_DATA || i == cereal::Event::Which::CAR_PARAMS;
+  }
+
   route_ = std::make_unique<Route>(route, data_dir);
-  events_ = std::make_unique<std::vector<Event *>>();
-  new_events_ = std::make_unique<std::vector<Event *>>();
 }
 
 Replay::~Replay() {
@@ -135,14 +141,21 @@ void Replay::buildTimeline() {
     [(int)cereal::ControlsState::AlertStatus::CRITICAL] = TimelineType::AlertCritical,
   };
 
+  // thumbnails are used by the qLogLoaded receivers
+  std::vector<bool> filters(sockets_.size(), false);
+  for (auto which : {cereal::Event::Which::CONTROLS_STATE, cereal::Event::Which::USER_FLAG, cereal::Event::Which::THUMBNAIL}) {
+    filters[which] = true;
+  }
+
   const auto &route_segments = route_->segments();
   for (auto it = route_segments.cbegin(); it != route_segments.cend() && !exit_; ++it) {
-    std::shared_ptr<LogReader> log(new LogReader());
+    std::shared_ptr<LogReader> log(new LogReader(filters));
     if (!log->load(it->second.qlog.toStdString(), &exit_, !hasFlag(REPLAY_FLAG_NO_FILE_CACHE), 0, 3)) continue;
 
     for (const Event *e : log->events) {
       if (e->which == cereal::Event::Which::CONTROLS_STATE) {
-        auto cs = e->event.getControlsState();
+        capnp::FlatArrayMessageReader reader(e->words);
+        auto cs = reader.getRoot<cereal::Event>().getControlsState();
 
         if (engaged != cs.getEnabled()) {
           if (engaged) {
@@ -224,14 +237,32 @@ void Replay::queueSegment() {
   auto cur = segments_.lower_bound(current_segment_.load());
   if (cur == segments_.end()) return;
 
-  auto begin = std::prev(cur, std::min<int>(segment_cache_limit / 2, std::distance(segments_.begin(), cur)));
-  auto end = std::next(begin, std::min<int>(segment_cache_limit, segments_.size()));
-  // load one segment at a time
-  auto it = std::find_if(cur, end, [](auto &it) { return !it.second || !it.second->isLoaded(); });
-  if (it != end && !it->second) {
+  // keep fewer segments behind and more ahead as the playback speed goes up
+  const float speed = std::max(1.0f, speed_.load());
+  int behind = segment_cache_limit / 2 / speed;
+  auto begin = std::prev(cur, std::min<int>(behind, std::distance(segments_.begin(), cur)));
+  auto end = std::next(begin, std::min<int>(segment_cache_limit, std::distance(begin, segments_.end())));
+
+  // load the current segment first, once it is loaded prefetch the segments ahead and then behind it in parallel.
+  // the files of a segment are loaded on the global thread pool, which is sized to the number of cores.
+  auto load_segment = [this](SegmentMap::iterator it) {
     rDebug("loading segment %d...", it->first);
-    it->second = std::make_unique<Segment>(it->first, route_->at(it->first), flags_);
+    it->second = std::make_unique<Segment>(it->first, route_->at(it->first), flags_, filters_);
     QObject::connect(it->second.get(), &Segment::loadFinished, this, &Replay::segmentLoadFinished);
+  };
+  if (!cur->second) {
+    load_segment(cur);
+  } else if (cur->second->isLoaded()) {
+    const int max_loading = std::max(2, (int)std::ceil(speed));
+    int loading = std::count_if(begin, end, [](auto &it) { return it.second && !it.second->isLoaded(); });
+    auto prefetch = [&](SegmentMap::iterator it) {
+      if (!it->second && loading < max_loading) {
+        load_segment(it);
+        ++loading;
+      }
+    };
+    for (auto it = std::next(cur); it != end; ++it) prefetch(it);
+    for (auto it = cur; it != begin;) prefetch(--it);
   }
 
   mergeSegments(begin, end);
@@ -250,11 +281,11 @@ void Replay::queueSegment() {
 
 void Replay::mergeSegments(const SegmentMap::iterator &begin, const SegmentMap::iterator &end) {
   std::vector<int> segments_need_merge;
-  size_t new_events_size = 0;
+  std::map<int, const std::vector<Event *> *> runs;
   for (auto it = begin; it != end; ++it) {
     if (it->second && it->second->isLoaded()) {
       segments_need_merge.push_back(it->first);
-      new_events_size += it->second->log->events.size();
+      runs[it->first] = &it->second->log->events;
     }
   }
 
@@ -265,21 +296,14 @@ void Replay::mergeSegments(const SegmentMap::iterator &begin, const SegmentMap::
       if (i != segments_need_merge.size() - 1) s += ", ";
     }
     rDebug("merge segments %s", s.c_str());
-    new_events_->clear();
-    new_events_->reserve(new_events_size);
-    for (int n : segments_need_merge) {
-      size_t size = new_events_->size();
-      const auto &events = segments_[n]->log->events;
-      std::copy_if(events.begin(), events.end(), std::back_inserter(*new_events_),
-                   [this](auto e) { return e->which < sockets_.size() && sockets_[e->which] != nullptr; });
-      std::inplace_merge(new_events_->begin(), new_events_->begin() + size, new_events_->end(), Event::lessThan());
-    }
 
     if (stream_thread_) {
       emit segmentsMerged();
     }
+    // the events are not copied, the stream thread only has to reposition its cursor
     updateEvents([&]() {
-      events_.swap(new_events_);
+      events_.setRuns(std::move(runs));
+      last_event_mono_time_ = !events_.empty() ? events_.back()->mono_time : 0;
       segments_merged_ = segments_need_merge;
       // Do not wake up the stream thread if the current segment has not been merged.
       return isSegmentMerged(current_segment_) || (segments_.count(current_segment_) == 0);
@@ -297,9 +321,11 @@ void Replay::startStream(const Segment *cur_segment) {
   // write CarParams
   auto it = std::find_if(events.begin(), events.end(), [](auto e) { return e->which == cereal::Event::Which::CAR_PARAMS; });
   if (it != events.end()) {
-    car_fingerprint_ = (*it)->event.getCarParams().getCarFingerprint();
+    capnp::FlatArrayMessageReader reader((*it)->words);
+    auto car_params = reader.getRoot<cereal::Event>().getCarParams();
+    car_fingerprint_ = car_params.getCarFingerprint();
     capnp::MallocMessageBuilder builder;
-    builder.setRoot((*it)->event.getCarParams());
+    builder.setRoot(car_params);
     auto words = capnp::messageToFlatArray(builder);
     auto bytes = words.asBytes();
     Params().put("CarParams", (const char *)bytes.begin(), bytes.size());
@@ -340,7 +366,8 @@ void Replay::publishMessage(const Event *e) {
       sockets_[e->which] = nullptr;
     }
   } else {
-    sm->update_msgs(nanos_since_boot(), {{sockets_[e->which], e->event}});
+    capnp::FlatArrayMessageReader reader(e->words);
+    sm->update_msgs(nanos_since_boot(), {{sockets_[e->which], reader.getRoot<cereal::Event>()}});
   }
 }
 
@@ -354,10 +381,11 @@ void Replay::publishFrame(const Event *e) {
       (e->which == cereal::Event::WIDE_ROAD_ENCODE_IDX && !hasFlag(REPLAY_FLAG_ECAM))) {
     return;
   }
-  auto eidx = capnp::AnyStruct::Reader(e->event).getPointerSection()[0].getAs<cereal::EncodeIndex>();
+  capnp::FlatArrayMessageReader reader(e->words);
+  auto eidx = capnp::AnyStruct::Reader(reader.getRoot<cereal::Event>()).getPointerSection()[0].getAs<cereal::EncodeIndex>();
   if (eidx.getType() == cereal::EncodeIndex::Type::FULL_H_E_V_C && isSegmentMerged(eidx.getSegmentNum())) {
     CameraType cam = cam_types.at(e->which);
-    camera_server_->pushFrame(cam, segments_[eidx.getSegmentNum()]->frames[cam].get(), eidx);
+    camera_server_->pushFrame(cam, segments_[eidx.getSegmentNum()]->frames[cam], eidx);
   }
 }
 
@@ -372,8 +400,8 @@ void Replay::stream() {
     if (exit_) break;
 
     Event cur_event(cur_which, cur_mono_time_);
-    auto eit = std::upper_bound(events_->begin(), events_->end(), &cur_event, Event::lessThan());
-    if (eit == events_->end()) {
+    auto eit = events_.upperBound(&cur_event);
+    if (eit.end()) {
       rInfo("waiting for events...");
       continue;
     }
@@ -381,7 +409,7 @@ void Replay::stream() {
     uint64_t evt_start_ts = cur_mono_time_;
     uint64_t loop_start_ts = nanos_since_boot();
 
-    for (auto end = events_->end(); !updating_events_ && eit != end; ++eit) {
+    for (; !updating_events_ && !eit.end(); ++eit) {
       const Event *evt = (*eit);
       cur_which = evt->which;
       cur_mono_time_ = evt->mono_time;
@@ -417,7 +445,7 @@ void Replay::stream() {
       camera_server_->waitForSent();
     }
 
-    if (eit == events_->end() && !hasFlag(REPLAY_FLAG_NO_LOOP)) {
+    if (eit.end() && !hasFlag(REPLAY_FLAG_NO_LOOP)) {
       int last_segment = segments_.empty() ? 0 : segments_.rbegin()->first;
       if (current_segment_ >= last_segment && isSegmentMerged(last_segment)) {
         rInfo("reaches the end of route, restart from beginning");
@@ -426,3 +454,46 @@ void Replay::stream() {
     }
   }
 }
+
+// class MergedEvents
+
+MergedEvents::Cursor MergedEvents::upperBound(const Event *e) const {
+  Cursor cursor;
+  for (const auto &[n, events] : runs_) {
+    auto it = std::upper_bound(events->begin(), events->end(), e, Event::lessThan());
+    if (it != events->end()) {
+      cursor.heads_.push_back({it, events->end()});
+    }
+  }
+  cursor.findNext();
+  return cursor;
+}
+
+const Event *MergedEvents::back() const {
+  const Event *last = nullptr;
+  for (const auto &[n, events] : runs_) {
+    if (!last || Event::lessThan()(last, events->back())) {
+      last = events->back();
+    }
+  }
+  return last;
+}
+
+MergedEvents::Cursor &MergedEvents::Cursor::operator++() {
+  auto &[it, end] = heads_[cur_];
+  if (++it == end) {
+    heads_.erase(heads_.begin() + cur_);
+  }
+  findNext();
+  return *this;
+}
+
+void MergedEvents::Cursor::findNext() {
+  // only a handful of segments are cached, a linear scan of the run heads is cheaper than a heap
+  cur_ = 0;
+  for (size_t i = 1; i < heads_.size(); ++i) {
+    if (Event::lessThan()(*heads_[i].first, *heads_[cur_].first)) {
+      cur_ = i;
+    }
+  }
+}
@@ -44,6 +44,33 @@ enum class TimelineType { None, Engaged, AlertInfo, AlertWarning, AlertCritical,
 typedef bool (*replayEventFilter)(const Event *, void *);
 Q_DECLARE_METATYPE(std::shared_ptr<LogReader>);
 
+// The events of the merged segments, kept as one sorted run per segment. Merging or evicting
+// a segment only adds or removes its run, Cursor walks all runs in time order (k-way merge).
+class MergedEvents {
+public:
+  class Cursor {
+  public:
+    inline bool end() const { return heads_.empty(); }
+    inline const Event *operator*() const { return *heads_[cur_].first; }
+    Cursor &operator++();
+
+  private:
+    friend class MergedEvents;
+    void findNext();
+    std::vector<std::pair<std::vector<Event *>::const_iterator, std::vector<Event *>::const_iterator>> heads_;
+    size_t cur_ = 0;
+  };
+
+  // returns a cursor at the first event after e
+  Cursor upperBound(const Event *e) const;
+  const Event *back() const;
+  inline bool empty() const { return runs_.empty(); }
+  inline void setRuns(std::map<int, const std::vector<Event *> *> &&runs) { runs_ = std::move(runs); }
+
+private:
+  std::map<int, const std::vector<Event *> *> runs_;
+};
+
 class Replay : public QObject {
   Q_OBJECT
 
@@ -78,7 +105,8 @@ public:
   inline int totalSeconds() const { return (!segments_.empty()) ? (segments_.rbegin()->first + 1) * 60 : 0; }
   inline void setSpeed(float speed) { speed_ = speed; }
   inline float getSpeed() const { return speed_; }
-  inline const std::vector<Event *> *events() const { return events_.get(); }
+  // mono time of the last merged event, 0 if there are none
+  inline uint64_t lastEventMonoTime() const { return last_event_mono_time_; }
   inline const std::map<int, std::unique_ptr<Segment>> &segments() const { return segments_; }
   inline const std::string &carFingerprint() const { return car_fingerprint_; }
   inline const std::vector<std::tuple<double, double, TimelineType>> getTimeline() {
@@ -123,14 +151,16 @@ protected:
   bool events_updated_ = false;
   uint64_t route_start_ts_ = 0;
   std::atomic<uint64_t> cur_mono_time_ = 0;
-  std::unique_ptr<std::vector<Event *>> events_;
-  std::unique_ptr<std::vector<Event *>> new_events_;
+  MergedEvents events_;
   std::vector<int> segments_merged_;
+  // set with events_, readable without stream_lock_, which the stream thread holds while playing
+  std::atomic<uint64_t> last_event_mono_time_ = 0;
 
   // messaging
   SubMaster *sm = nullptr;
   std::unique_ptr<PubMaster> pm;
   std::vector<const char*> sockets_;
+  std::vector<bool> filters_;
   std::unique_ptr<Route> route_;
   std::unique_ptr<CameraServer> camera_server_;
   std::atomic<uint32_t> flags_ = REPLAY_FLAG_NONE;
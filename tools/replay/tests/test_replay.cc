@@ -1,4 +1,7 @@
+#include <bzlib.h>
+
 #include <chrono>
+#include <random>
 #include <thread>
 
 #include <QDebug>
@@ -58,6 +61,39 @@ TEST_CASE("FileReader") {
   }
 }
 
+std::string compressBZ2(const std::string &in, int block_size_100k) {
+  unsigned int out_size = in.size() * 1.01 + 600;
+  std::string out(out_size, '\0');
+  REQUIRE(BZ2_bzBuffToBuffCompress(out.data(), &out_size, (char *)in.data(), in.size(), block_size_100k, 0, 0) == BZ_OK);
+  out.resize(out_size);
+  return out;
+}
+
+TEST_CASE("decompressBZ2") {
+  // 100k blocks, which end at arbitrary bit offsets, in two concatenated streams
+  std::mt19937 rng(0);
+  std::string content;
+  while (content.size() < 500 * 1024) {
+    content += std::to_string(rng() % 1000) + (rng() % 8 == 0 ? "\n" : " ");
+  }
+  const size_t split = 300 * 1024;
+  std::string compressed = compressBZ2(content.substr(0, split), 1) + compressBZ2(content.substr(split), 1);
+
+  SECTION("complete") {
+    REQUIRE(decompressBZ2(compressed, nullptr, 1) == content);
+    REQUIRE(decompressBZ2(compressed, nullptr, 4) == content);
+  }
+  SECTION("truncated") {
+    for (size_t size : {compressed.size() / 4, compressed.size() / 2, compressed.size() * 3 / 4, compressed.size() - 1}) {
+      std::string truncated = compressed.substr(0, size);
+      std::string sequential = decompressBZ2(truncated, nullptr, 1);
+      REQUIRE(!sequential.empty());
+      REQUIRE(content.compare(0, sequential.size(), sequential) == 0);
+      REQUIRE(decompressBZ2(truncated, nullptr, 4) == sequential);
+    }
+  }
+}
+
 TEST_CASE("LogReader") {
   SECTION("corrupt log") {
     FileReader reader(true);
@@ -68,6 +104,25 @@ TEST_CASE("LogReader") {
     REQUIRE(log.load((std::byte *)corrupt_content.data(), corrupt_content.size()));
     REQUIRE(log.events.size() > 0);
   }
+  SECTION("filter services") {
+    LogReader log;
+    REQUIRE(log.load(TEST_RLOG_URL, nullptr, true));
+    size_t can_events = std::count_if(log.events.begin(), log.events.end(),
+                                      [](const Event *e) { return e->which == cereal::Event::Which::CAN; });
+    REQUIRE(can_events > 0);
+
+    std::vector<bool> filters(cereal::Event::Which::CAN + 1, false);
+    filters[cereal::Event::Which::CAN] = true;
+    LogReader can_log(filters);
+    REQUIRE(can_log.load(TEST_RLOG_URL, nullptr, true));
+    REQUIRE(can_log.events.size() == can_events);
+    REQUIRE(std::is_sorted(can_log.events.begin(), can_log.events.end(), Event::lessThan()));
+    for (const Event *e : can_log.events) {
+      REQUIRE(e->which == cereal::Event::Which::CAN);
+      capnp::FlatArrayMessageReader reader(e->words);
+      REQUIRE(reader.getRoot<cereal::Event>().getLogMonoTime() == e->mono_time);
+    }
+  }
 }
 
 void read_segment(int n, const SegmentFile &segment_file, uint32_t flags) {
@@ -158,6 +213,122 @@ TEST_CASE("Remote route") {
   }
 }
 
+// helper class for unit tests, tells which frames are in the cache
+class TestFrameCache : public FrameCache {
+ public:
+  using FrameCache::FrameCache;
+  const VisionBuf *cached(const FrameReader *fr, int id) {
+    std::lock_guard lk(lock_);
+    Slot *slot = find(fr, id);
+    return slot && slot->decoded ? &slot->buf : nullptr;
+  }
+  bool waitForDecoded(const FrameReader *fr, int from, int to) {
+    std::unique_lock lk(lock_);
+    return cv_.wait_for(lk, std::chrono::seconds(10), [&]() {
+      for (int i = from; i <= to; ++i) {
+        Slot *slot = find(fr, i);
+        if (!slot || !slot->decoded) return false;
+      }
+      return true;
+    });
+  }
+};
+
+std::string frame_hash(const VisionBuf *buf) {
+  std::string data;
+  for (size_t i = 0; i < buf->height; ++i) {
+    data.append((const char *)buf->y + i * buf->stride, buf->width);
+  }
+  for (size_t i = 0; i < buf->height / 2; ++i) {
+    data.append((const char *)buf->uv + i * buf->stride, buf->width);
+  }
+  return sha256(data);
+}
+
+TEST_CASE("FrameCache") {
+  const std::string route_name = DEMO_ROUTE.mid(17).toStdString();
+  const std::string video = download_demo_route() + "/" + route_name + "--0/dcamera.hevc";
+  auto fr = std::make_shared<FrameReader>();
+  REQUIRE(fr->load(video, true));
+  const int count = fr->getFrameCount();
+
+  // key frame lookups at and between key frames
+  std::vector<int> key_frames;
+  for (int i = 0; i < count; ++i) {
+    const int key_frame = fr->keyFrameIndex(i);
+    REQUIRE(key_frame <= i);
+    if (key_frame == i) {
+      key_frames.push_back(i);
+    } else {
+      REQUIRE(key_frame == key_frames.back());
+    }
+  }
+  REQUIRE(key_frames.size() > 1);
+  REQUIRE(key_frames[0] == 0);
+  REQUIRE(fr->keyFrameIndex(count + 10) == key_frames.back());
+
+  // reference frames of the first two GOPs, decoded in order
+  const int gop_begin = key_frames[1];
+  const int gop_end = key_frames.size() > 2 ? key_frames[2] : count;
+  std::vector<std::string> hashes;
+  {
+    FrameReader reader;
+    REQUIRE(reader.load(video, true));
+    auto [nv12_width, nv12_height, nv12_buffer_size] = get_nv12_info(reader.width, reader.height);
+    VisionBuf buf;
+    buf.allocate(nv12_buffer_size);
+    buf.init_yuv(reader.width, reader.height, nv12_width, nv12_width * nv12_height);
+    for (int i = 0; i < gop_end; ++i) {
+      REQUIRE(reader.get(i, &buf));
+      hashes.push_back(frame_hash(&buf));
+    }
+    buf.free();
+  }
+
+  // random access starts decoding at the key frame
+  {
+    FrameReader reader;
+    REQUIRE(reader.load(video, true));
+    auto [nv12_width, nv12_height, nv12_buffer_size] = get_nv12_info(reader.width, reader.height);
+    VisionBuf buf;
+    buf.allocate(nv12_buffer_size);
+    buf.init_yuv(reader.width, reader.height, nv12_width, nv12_width * nv12_height);
+    for (int i : {gop_end - 1, gop_begin, gop_begin + 1}) {
+      REQUIRE(reader.get(i, &buf));
+      REQUIRE(frame_hash(&buf) == hashes[i]);
+    }
+    buf.free();
+  }
+
+  TestFrameCache cache(fr->width, fr->height);
+
+  // the frames after the requested one are decoded ahead, getting them doesn't wait for a decode
+  VisionBuf *buf = cache.get(fr, 0);
+  REQUIRE(buf != nullptr);
+  REQUIRE(frame_hash(buf) == hashes[0]);
+  REQUIRE(cache.waitForDecoded(fr.get(), 0, DECODE_AHEAD_FRAMES - 1));
+  for (int i = 1; i < DECODE_AHEAD_FRAMES && i < gop_end; ++i) {
+    const VisionBuf *ahead = cache.cached(fr.get(), i);
+    REQUIRE(ahead != nullptr);
+    REQUIRE(cache.get(fr, i) == ahead);
+    REQUIRE(frame_hash(ahead) == hashes[i]);
+  }
+
+  // stepping backward inside a GOP keeps the frames from the key frame up to the requested one
+  buf = cache.get(fr, gop_end - 1);
+  REQUIRE(buf != nullptr);
+  REQUIRE(frame_hash(buf) == hashes[gop_end - 1]);
+  for (int i = gop_end - 2; i >= gop_begin; --i) {
+    const VisionBuf *ahead = i < gop_end - 2 ? cache.cached(fr.get(), i) : nullptr;
+    REQUIRE((i == gop_end - 2 || ahead != nullptr));
+    buf = cache.get(fr, i);
+    REQUIRE(buf != nullptr);
+    REQUIRE((!ahead || buf == ahead));
+    REQUIRE(frame_hash(buf) == hashes[i]);
+    REQUIRE(cache.waitForDecoded(fr.get(), std::max(gop_begin, i - DECODE_AHEAD_FRAMES + 1), i));
+  }
+}
+
 // helper class for unit tests
 class TestReplay : public Replay {
  public:
@@ -179,15 +350,21 @@ void TestReplay::testSeekTo(int seek_to) {
     }
 
     Event cur_event(cereal::Event::Which::INIT_DATA, cur_mono_time_);
-    auto eit = std::upper_bound(events_->begin(), events_->end(), &cur_event, Event::lessThan());
-    if (eit == events_->end()) {
+    auto eit = events_.upperBound(&cur_event);
+    if (eit.end()) {
       qDebug() << "waiting for events...";
       continue;
     }
 
-    REQUIRE(std::is_sorted(events_->begin(), events_->end(), Event::lessThan()));
     const int seek_to_segment = seek_to / 60;
     const int event_seconds = ((*eit)->mono_time - route_start_ts_) / 1e9;
+    const Event *prev = nullptr;
+    bool sorted = true;
+    for (auto it = events_.upperBound(&cur_event); !it.end() && sorted; ++it) {
+      sorted = !prev || !Event::lessThan()(*it, prev);
+      prev = *it;
+    }
+    REQUIRE(sorted);
     current_segment_ = event_seconds / 60;
     INFO("seek to [" << seek_to << "s segment " << seek_to_segment << "], events [" << event_seconds << "s segment" << current_segment_ << "]");
     REQUIRE(event_seconds >= seek_to);
@@ -13,7 +13,9 @@
 #include <map>
 #include <mutex>
 #include <numeric>
+#include <thread>
 #include <utility>
+#include <vector>
 
 #include "common/timing.h"
 #include "common/util.h"
@@ -263,30 +265,35 @@ bool httpDownload(const std::string &url, const std::string &file, size_t chunk_
   return httpDownload(url, of, chunk_size, size, abort);
 }
 
-std::string decompressBZ2(const std::string &in, std::atomic<bool> *abort) {
-  return decompressBZ2((std::byte *)in.data(), in.size(), abort);
+std::string decompressBZ2(const std::string &in, std::atomic<bool> *abort, int threads) {
+  return decompressBZ2((std::byte *)in.data(), in.size(), abort, threads);
 }
 
-std::string decompressBZ2(const std::byte *in, size_t in_size, std::atomic<bool> *abort) {
-  if (in_size == 0) return {};
+namespace {
+
+const uint64_t BZ2_BLOCK_MAGIC = 0x314159265359;
+const uint64_t BZ2_EOS_MAGIC = 0x177245385090;
 
+// decompresses one bz2 stream and appends it to out, setting consumed to the size of the stream.
+// returns BZ_STREAM_END if the stream is complete, BZ_OK if it is truncated or corrupt, with the
+// blocks decoded so far in out.
+int decompressStream(const std::byte *in, size_t in_size, std::string &out, size_t *consumed, std::atomic<bool> *abort) {
   bz_stream strm = {};
   int bzerror = BZ2_bzDecompressInit(&strm, 0, 0);
   assert(bzerror == BZ_OK);
 
+  const size_t base = out.size();
   strm.next_in = (char *)in;
   strm.avail_in = in_size;
-  std::string out(in_size * 5, '\0');
+  out.resize(base + in_size * 5);
   do {
-    strm.next_out = (char *)(&out[strm.total_out_lo32]);
-    strm.avail_out = out.size() - strm.total_out_lo32;
+    strm.next_out = (char *)(&out[base + strm.total_out_lo32]);
+    strm.avail_out = out.size() - base - strm.total_out_lo32;
 
     const char *prev_write_pos = strm.next_out;
     bzerror = BZ2_bzDecompress(&strm);
     if (bzerror == BZ_OK && prev_write_pos == strm.next_out) {
       // content is corrupt
-      bzerror = BZ_STREAM_END;
-      rWarning("decompressBZ2 error : content is corrupt");
       break;
     }
 
@@ -295,9 +302,167 @@ std::string decompressBZ2(const std::byte *in, size_t in_size, std::atomic<bool>
     }
   } while (bzerror == BZ_OK && !(abort && *abort));
 
+  out.resize(base + strm.total_out_lo32);
+  *consumed = in_size - strm.avail_in;
   BZ2_bzDecompressEnd(&strm);
+  return bzerror;
+}
+
+// decompresses all the concatenated streams in the data like bzip2 does, ignoring trailing garbage
+int decompressStreams(const std::byte *in, size_t in_size, std::string &out, std::atomic<bool> *abort) {
+  size_t consumed = 0;
+  int bzerror = decompressStream(in, in_size, out, &consumed, abort);
+  in += consumed;
+  in_size -= consumed;
+  while (bzerror == BZ_STREAM_END && in_size >= 4 && memcmp(in, "BZh", 3) == 0 && !(abort && *abort)) {
+    bzerror = decompressStream(in, in_size, out, &consumed, abort);
+    in += consumed;
+    in_size -= consumed;
+  }
+  return bzerror;
+}
+
+// helper threads available to decompress blocks in parallel, shared by all calls. segments are
+// already loaded in parallel, so concurrent calls split the cores instead of each taking all of them.
+std::atomic<int> bz2_helper_threads = std::max<int>(std::thread::hardware_concurrency() - 1, 0);
+
+int acquireHelperThreads(int wanted) {
+  int available = bz2_helper_threads.load();
+  int n = 0;
+  do {
+    n = std::min(wanted, available);
+  } while (n > 0 && !bz2_helper_threads.compare_exchange_weak(available, available - n));
+  return std::max(n, 0);
+}
+
+struct BitWriter {
+  void put(uint64_t value, int bits) {
+    while (bits-- > 0) {
+      cur = (cur << 1) | ((value >> bits) & 1);
+      if (++cur_bits == 8) flush();
+    }
+  }
+  void flush() {
+    if (cur_bits > 0) {
+      out.push_back(cur << (8 - cur_bits));
+      cur = cur_bits = 0;
+    }
+  }
+  std::string out;
+  uint8_t cur = 0;
+  int cur_bits = 0;
+};
+
+// wraps the bits [begin, end) of one compressed block into a standalone single block stream.
+// blocks are bit aligned, so they are shifted to the byte aligned position after the stream header.
+std::string bz2BlockStream(const uint8_t *in, uint64_t begin, uint64_t end) {
+  auto bit = [in](uint64_t pos) { return (in[pos >> 3] >> (7 - (pos & 7))) & 1; };
+
+  BitWriter w;
+  w.out.reserve((end - begin) / 8 + 16);
+  w.out = "BZh9";
+  const uint64_t b = begin / 8, shift = begin % 8, bytes = (end - begin) / 8;
+  for (uint64_t i = 0; i < bytes; ++i) {
+    w.out.push_back(shift == 0 ? in[b + i] : (in[b + i] << shift) | (in[b + i + 1] >> (8 - shift)));
+  }
+  for (uint64_t pos = begin + bytes * 8; pos < end; ++pos) {
+    w.put(bit(pos), 1);
+  }
+
+  // the combined crc of a single block stream is the crc of the block, which follows the block magic
+  uint32_t crc = 0;
+  for (uint64_t pos = begin + 48; pos < begin + 80; ++pos) {
+    crc = (crc << 1) | bit(pos);
+  }
+  w.put(BZ2_EOS_MAGIC, 48);
+  w.put(crc, 32);
+  w.flush();
+  return w.out;
+}
+
+// returns the bit ranges of the complete blocks in the compressed data. a trailing block
+// without end of stream marker is truncated and left out, as the sequential decoder can't decode it either.
+std::vector<std::pair<uint64_t, uint64_t>> bz2Blocks(const uint8_t *in, size_t in_size, bool *truncated) {
+  std::vector<std::pair<uint64_t, uint64_t>> blocks;
+  uint64_t block_begin = 0, reg = 0;
+  bool in_block = false;
+  for (size_t i = 0; i < in_size; ++i) {
+    reg = (reg << 8) | in[i];
+    if (i < 6) continue;
+
+    for (int shift = 7; shift >= 0; --shift) {
+      uint64_t magic = (reg >> shift) & 0xFFFFFFFFFFFF;
+      if (magic != BZ2_BLOCK_MAGIC && magic != BZ2_EOS_MAGIC) continue;
+
+      uint64_t pos = (i + 1) * 8 - shift - 48;
+      if (in_block) {
+        blocks.push_back({block_begin, pos});
+      }
+      in_block = magic == BZ2_BLOCK_MAGIC;
+      block_begin = pos;
+    }
+  }
+  *truncated = in_block;
+  return blocks;
+}
+
+}  // namespace
+
+std::string decompressBZ2(const std::byte *in, size_t in_size, std::atomic<bool> *abort, int threads) {
+  if (in_size == 0) return {};
+
+  // blocks are independent, decompress them in parallel when the stream has more than one
+  if (threads == 0) threads = std::thread::hardware_concurrency();
+  std::vector<std::pair<uint64_t, uint64_t>> blocks;
+  bool truncated = false;
+  if (threads > 1) {
+    blocks = bz2Blocks((const uint8_t *)in, in_size, &truncated);
+  }
+  if (blocks.size() > 1) {
+    std::vector<std::string> outputs(blocks.size());
+    std::atomic<size_t> next = 0;
+    std::atomic<bool> failed = false;
+    auto worker = [&]() {
+      for (size_t i = next++; i < blocks.size() && !failed && !(abort && *abort); i = next++) {
+        std::string stream = bz2BlockStream((const uint8_t *)in, blocks[i].first, blocks[i].second);
+        size_t consumed = 0;
+        if (decompressStream((const std::byte *)stream.data(), stream.size(), outputs[i], &consumed, abort) != BZ_STREAM_END) {
+          failed = true;
+        }
+      }
+    };
+    const int helpers = acquireHelperThreads(std::min<int>(threads, blocks.size()) - 1);
+    std::vector<std::thread> helper_threads;
+    for (int i = 0; i < helpers; ++i) {
+      helper_threads.emplace_back(worker);
+    }
+    worker();
+    for (auto &t : helper_threads) t.join();
+    bz2_helper_threads += helpers;
+
+    if (abort && *abort) return {};
+    if (!failed) {
+      if (truncated) {
+        rWarning("decompressBZ2 error : content is corrupt");
+      }
+      size_t total = 0;
+      for (const auto &o : outputs) total += o.size();
+      std::string out;
+      out.reserve(total);
+      for (const auto &o : outputs) out += o;
+      return out;
+    }
+    // a block magic inside the compressed data split a block, fall back to sequential decompression
+    rWarning("decompressBZ2: failed to split blocks, decompressing sequentially");
+  }
+
+  std::string out;
+  int bzerror = decompressStreams(in, in_size, out, abort);
+  if (bzerror == BZ_OK && !(abort && *abort)) {
+    rWarning("decompressBZ2 error : content is corrupt");
+    bzerror = BZ_STREAM_END;
+  }
   if (bzerror == BZ_STREAM_END && !(abort && *abort)) {
-    out.resize(strm.total_out_lo32);
     return out;
   }
   return {};
@@ -22,8 +22,9 @@ void logMessage(ReplyMsgType type, const char* fmt, ...);
 
 std::string sha256(const std::string &str);
 void precise_nano_sleep(long sleep_ns);
-std::string decompressBZ2(const std::string &in, std::atomic<bool> *abort = nullptr);
-std::string decompressBZ2(const std::byte *in, size_t in_size, std::atomic<bool> *abort = nullptr);
+// threads is the most threads decompressing blocks in parallel, 0 for one per core and 1 to decompress sequentially
+std::string decompressBZ2(const std::string &in, std::atomic<bool> *abort = nullptr, int threads = 0);
+std::string decompressBZ2(const std::byte *in, size_t in_size, std::atomic<bool> *abort = nullptr, int threads = 0);
 std::string getUrlWithoutQuery(const std::string &url);
 size_t getRemoteFileSize(const std::string &url, std::atomic<bool> *abort = nullptr);
 std::string httpGet(const std::string &url, size_t chunk_size = 0, std::atomic<bool> *abort = nullptr);